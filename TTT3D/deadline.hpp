@@ -16,6 +16,21 @@ static inline double get_cpu_time() {
         return 0;
     }
 }
+static inline double get_thread_cpu_time() {
+    FILETIME a,b,c,d;
+    if (GetThreadTimes(GetCurrentThread(),&a,&b,&c,&d) != 0){
+        return (double)(d.dwLowDateTime |
+            ((unsigned long long)d.dwHighDateTime << 32)) * 0.0000001;
+    } else {
+        return 0;
+    }
+}
+static inline double get_wall_time() {
+    LARGE_INTEGER t, f;
+    QueryPerformanceCounter(&t);
+    QueryPerformanceFrequency(&f);
+    return (double)t.QuadPart / f.QuadPart;
+}
 
 // Posix/Linux
 #else
@@ -24,6 +39,16 @@ static inline double get_cpu_time() {
 static inline double get_cpu_time() {
     return (double)clock() / CLOCKS_PER_SEC;
 }
+static inline double get_thread_cpu_time() {
+    struct timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+static inline double get_wall_time() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
 #endif
 
 namespace TICTACTOE3D {
@@ -70,6 +95,20 @@ public:
         return Deadline(get_cpu_time());
     }
 
+    //Returns a Deadline object representing the CPU time of the calling thread in seconds,
+    //for programs searching several games at once
+    static Deadline threadNow()
+    {
+        return Deadline(get_thread_cpu_time());
+    }
+
+    //Returns a Deadline object representing the time elapsed in seconds (from an unspecified
+    //start), the same for all threads; for searches that move between threads
+    static Deadline wallNow()
+    {
+        return Deadline(get_wall_time());
+    }
+
     //Returns the value of this deadline in seconds.
     double getSeconds() const    {    return mTime;    }
 
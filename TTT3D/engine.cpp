@@ -0,0 +1,69 @@
+#include "engine.hpp"
+#include <chrono>
+
+namespace TICTACTOE3D
+{
+
+std::vector<int> Engine::legalMoves(const GameState &pState)
+{
+    std::vector<GameState> lNext;
+    pState.findPossibleMoves(lNext);
+    std::vector<int> lCells;
+    lCells.reserve(lNext.size());
+    for (std::size_t i = 0; i < lNext.size(); ++i)
+        lCells.push_back(lNext[i].getMove()[0]);
+    return lCells;
+}
+
+bool Engine::playMove(GameState &pState, int pCell)
+{
+    // The state after the move says whether it ends the game, so take it from the move generator
+    std::vector<GameState> lNext;
+    pState.findPossibleMoves(lNext);
+    for (std::size_t i = 0; i < lNext.size(); ++i)
+        if (lNext[i].getMove()[0] == pCell)
+        {
+            pState = lNext[i];
+            return true;
+        }
+    return false;
+}
+
+Engine::Analysis Engine::analyze(const GameState &pState, const Limits &pLimits)
+{
+    int lDepth = mPlayer.getDepth();
+    uint64_t lNodes = mPlayer.getNodeLimit();
+    int lMultiPV = mPlayer.getMultiPV();
+    if (pLimits.mDepth > 0)
+        mPlayer.setDepth(pLimits.mDepth);
+    if (pLimits.mNodes > 0)
+        mPlayer.setNodeLimit(pLimits.mNodes);
+    if (pLimits.mMultiPV > 0)
+        mPlayer.setMultiPV(pLimits.mMultiPV);
+    Deadline lDue = pLimits.mSeconds > 0 ? mPlayer.now() + pLimits.mSeconds : Deadline();
+
+    std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+    Analysis lAnalysis;
+    lAnalysis.mNext = mPlayer.play(pState, lDue);
+    lAnalysis.mSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+    mPlayer.setDepth(lDepth);
+    mPlayer.setNodeLimit(lNodes);
+    mPlayer.setMultiPV(lMultiPV);
+
+    if (legalMoves(pState).empty())
+    {
+        lAnalysis.mCell = -1;
+        lAnalysis.mScore = 0;
+        lAnalysis.mDepth = 0;
+        lAnalysis.mNodes = 0;
+        return lAnalysis;
+    }
+    lAnalysis.mCell = lAnalysis.mNext.getMove()[0];
+    lAnalysis.mScore = mPlayer.getLastScore();
+    lAnalysis.mDepth = mPlayer.getLastDepth();
+    lAnalysis.mNodes = mPlayer.getLastNodes();
+    lAnalysis.mLines = mPlayer.getLines();
+    return lAnalysis;
+}
+
+/*namespace TICTACTOE3D*/ }
@@ -0,0 +1,86 @@
+#ifndef _TICTACTOE3D_ENGINE_HPP_
+#define _TICTACTOE3D_ENGINE_HPP_
+
+#include "gamestate.hpp"
+#include "player.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * The engine as a library: what TTT does, without the standard input and output
+ *
+ * Everything but main.cpp builds into libttt3d (see README_cpp); TTT is one
+ * client of it, tools and test harnesses can be others and search in their
+ * own process. ttt3d.h is the same interface for C and other languages.
+ *
+ *     Engine lEngine;
+ *     lEngine.configure("depth=4");
+ *     GameState lState;
+ *     Engine::playMove(lState, 21);
+ *     GameState lReply = lEngine.play(lState, 0.25);
+ *
+ * An engine searches one position at a time; use one per thread.
+ */
+class Engine
+{
+public:
+    ///what to search to in analyze(); 0 leaves a limit out
+    struct Limits
+    {
+        int mDepth = 0;             ///< plies, 0 for the depth=N of the engine
+        double mSeconds = 0;        ///< on the clock of the engine (see clock=)
+        uint64_t mNodes = 0;        ///< nodes, 0 for the nodes=N of the engine
+        int mMultiPV = 0;           ///< best moves to score exactly, 0 for the multipv=K of the engine
+    };
+
+    struct Analysis
+    {
+        GameState mNext;            ///< the state after the best move
+        int mCell;                  ///< cell of the best move, -1 if there is no move
+        double mScore;              ///< for the side to move
+        int mDepth;                 ///< deepest depth completed
+        uint64_t mNodes;
+        double mSeconds;
+        std::vector<Player::Line> mLines;   ///< the best moves, best first (see Player::getLines)
+    };
+
+    ///applies an engine option "name=value", as given to TTT (see Player::configure)
+    bool configure(const std::string &pOption)  {   return mPlayer.configure(pOption);  }
+
+    ///the cells the side to move can play in \p pState
+    static std::vector<int> legalMoves(const GameState &pState);
+
+    ///plays \p pCell in \p pState, returns false (and leaves it) if the move is not legal
+    static bool playMove(GameState &pState, int pCell);
+
+    ///our reply to \p pState, to be sent before \p pDue
+    GameState play(const GameState &pState, const Deadline &pDue)   {   return mPlayer.play(pState, pDue);  }
+
+    ///our reply to \p pState within \p pSeconds from now
+    GameState play(const GameState &pState, double pSeconds)
+    {
+        return mPlayer.play(pState, mPlayer.now() + pSeconds);
+    }
+
+    ///searches \p pState within \p pLimits; the K best moves come from the same search
+    ///(with the same table), they only make it a little wider
+    Analysis analyze(const GameState &pState, const Limits &pLimits);
+
+    ///the score and depth behind the last move played
+    double getLastScore() const     {   return mPlayer.getLastScore();  }
+    int getLastDepth() const        {   return mPlayer.getLastDepth();  }
+
+    ///the time on the clock the engine is timed with, to set deadlines on
+    Deadline now() const            {   return mPlayer.now();   }
+
+private:
+    Player mPlayer;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
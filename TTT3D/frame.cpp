@@ -0,0 +1,82 @@
+#include "frame.hpp"
+
+namespace TICTACTOE3D
+{
+
+namespace
+{
+
+void put(uint8_t *pTo, uint64_t pValue, int pBytes)
+{
+    for (int i = 0; i < pBytes; ++i)
+        pTo[i] = uint8_t(pValue >> (8 * i));
+}
+
+uint64_t get(const uint8_t *pFrom, int pBytes)
+{
+    uint64_t lValue = 0;
+    for (int i = 0; i < pBytes; ++i)
+        lValue |= uint64_t(pFrom[i]) << (8 * i);
+    return lValue;
+}
+
+/*namespace*/ }
+
+void Frame::encode(const GameState &pState, double pBudget)
+{
+    const Move &lMove = pState.getMove();
+    mBytes[0] = 'T';
+    mBytes[1] = '3';
+    mBytes[2] = cVersion;
+    mBytes[3] = pState.getNextPlayer();
+    mBytes[4] = uint8_t(int8_t(lMove.getType()));
+    mBytes[5] = lMove.length() > 0 ? lMove[0] : 0;
+    mBytes[6] = lMove.length() > 1 ? lMove[1] : 0;
+    mBytes[7] = 0;
+    put(mBytes + 8, pState.getPieces(CELL_X), 8);
+    put(mBytes + 16, pState.getPieces(CELL_O), 8);
+    put(mBytes + 24, pBudget > 0 ? uint32_t(pBudget * 1e6 + 0.5) : 0, 4);
+    put(mBytes + 28, 0, 4);
+}
+
+bool Frame::decode(GameState &pState, double &pBudget) const
+{
+    if (mBytes[0] != 'T' || mBytes[1] != '3' || mBytes[2] != cVersion)
+        return false;
+
+    uint8_t lNext = mBytes[3];
+    uint8_t lCell = mBytes[5];
+    uint8_t lPlayer = mBytes[6];
+    uint64_t lX = get(mBytes + 8, 8);
+    uint64_t lO = get(mBytes + 16, 8);
+    if ((lNext != CELL_X && lNext != CELL_O) || (lX & lO) || lCell >= GameState::cSquares)
+        return false;
+
+    // The moves of the text protocol, with their cell and player
+    Move lMove;
+    switch (int8_t(mBytes[4]))
+    {
+    case Move::MOVE_BOG:
+        break;
+    case Move::MOVE_NORMAL:
+        lMove = Move(lCell, Cell(lPlayer));
+        break;
+    case Move::MOVE_XW:
+    case Move::MOVE_OW:
+        lMove = Move(lCell, Cell(lPlayer), 1);
+        break;
+    case Move::MOVE_DRAW:
+        lMove = Move(lCell, Cell(lPlayer), 2);
+        break;
+    default:
+        return false;
+    }
+    if (lMove.getType() != int8_t(mBytes[4]) || (!lMove.isBOG() && lPlayer != CELL_X && lPlayer != CELL_O))
+        return false;
+
+    pState = GameState(lX, lO, lMove, lNext);
+    pBudget = get(mBytes + 24, 4) / 1e6;
+    return true;
+}
+
+/*namespace TICTACTOE3D*/ }
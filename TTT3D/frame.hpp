@@ -0,0 +1,46 @@
+#ifndef _TICTACTOE3D_FRAME_HPP_
+#define _TICTACTOE3D_FRAME_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * A state in the binary protocol, as an alternative to toMessage()
+ *
+ * Every frame has the same 32 bytes, all integers little endian:
+ *
+ *     0   'T' '3'        magic
+ *     2   uint8          version (1)
+ *     3   uint8          next player (CELL_X or CELL_O)
+ *     4   int8           type of the last move (Move::MoveType)
+ *     5   uint8          cell of the last move
+ *     6   uint8          player of the last move
+ *     7   uint8          0
+ *     8   uint64         cells held by X
+ *    16   uint64         cells held by O
+ *    24   uint32         time for the reply in microseconds, 0 for the default
+ *    28   uint32         0
+ *
+ * The frame needs no parsing beyond loading its fields, and having a fixed
+ * size it can be exchanged through shared memory as well as a pipe.
+ */
+struct Frame
+{
+    static const int cSize = 32;
+    static const uint8_t cVersion = 1;
+
+    uint8_t mBytes[cSize];
+
+    ///fills the frame with \p pState and a reply time of \p pBudget seconds (0 for the default)
+    void encode(const GameState &pState, double pBudget);
+
+    ///reads the frame into \p pState and \p pBudget, returns false if it is not a valid frame
+    bool decode(GameState &pState, double &pBudget) const;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -0,0 +1,308 @@
+#include "gamerecord.hpp"
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace TICTACTOE3D
+{
+
+namespace
+{
+
+const char cMagic[8] = { 'T', 'T', 'T', '3', 'G', 'A', 'M', 'E' };
+const uint8_t cVersion = 1;
+const uint8_t cFlagInfo = 1;
+const std::size_t cHeaderSize = 16;
+const std::size_t cInfoSize = 8;
+
+// Write to the file in blocks of this size
+const std::size_t cFlushSize = 1 << 20;
+
+void makeHeader(bool pInfo, unsigned char *pHeader)
+{
+    memset(pHeader, 0, cHeaderSize);
+    memcpy(pHeader, cMagic, sizeof(cMagic));
+    pHeader[8] = cVersion;
+    pHeader[9] = pInfo ? cFlagInfo : 0;
+}
+
+void putInfo(const MoveInfo &pInfo, unsigned char *pOut)
+{
+    uint32_t lScore;
+    memcpy(&lScore, &pInfo.mScore, sizeof(lScore));
+    for (int i = 0; i < 4; ++i)
+        pOut[i] = (unsigned char)(lScore >> (8 * i));
+    pOut[4] = (unsigned char)pInfo.mDepth;
+    pOut[5] = (unsigned char)(pInfo.mDepth >> 8);
+    pOut[6] = (unsigned char)pInfo.mTime;
+    pOut[7] = (unsigned char)(pInfo.mTime >> 8);
+}
+
+/*namespace*/ }
+
+void GameRecord::start(const GameState &pPosition)
+{
+    mCells.clear();
+    mInfo.clear();
+    mResult = RESULT_NONE;
+
+    // No intermediate position can hold a line the final one does not
+    uint64_t lX = pPosition.getPieces(CELL_X);
+    uint64_t lO = pPosition.getPieces(CELL_O);
+    while (lX || lO)
+    {
+        if (lX)
+        {
+            mCells.push_back((uint8_t)lowestBit(lX));
+            lX &= lX - 1;
+        }
+        if (lO)
+        {
+            mCells.push_back((uint8_t)lowestBit(lO));
+            lO &= lO - 1;
+        }
+    }
+    mInfo.assign(mCells.size(), MoveInfo());
+}
+
+void GameRecord::add(const GameState &pState, const MoveInfo &pInfo)
+{
+    const Move &lMove = pState.getMove();
+    if (lMove.isBOG())
+        return;
+    mCells.push_back(lMove[0]);
+    mInfo.push_back(pInfo);
+    if (lMove.isXWin())
+        mResult = RESULT_X;
+    else if (lMove.isOWin())
+        mResult = RESULT_O;
+    else if (lMove.isDraw())
+        mResult = RESULT_DRAW;
+}
+
+GameRecordWriter::GameRecordWriter(bool pInfo)
+    :   mInfo(pInfo),
+        mFile(0),
+        mOk(true)
+{
+}
+
+GameRecordWriter::~GameRecordWriter()
+{
+    close();
+}
+
+bool GameRecordWriter::open(const std::string &pFile)
+{
+    close();
+
+    unsigned char lHeader[cHeaderSize];
+    makeHeader(mInfo, lHeader);
+
+    // Append to an existing file only if its games have the same layout
+    FILE *lExisting = fopen(pFile.c_str(), "rb");
+    if (lExisting)
+    {
+        unsigned char lFound[cHeaderSize];
+        std::size_t lRead = fread(lFound, 1, cHeaderSize, lExisting);
+        fclose(lExisting);
+        if (lRead == cHeaderSize && memcmp(lFound, lHeader, cHeaderSize) == 0)
+        {
+            mFile = fopen(pFile.c_str(), "ab");
+            mOk = (mFile != 0);
+            return mOk;
+        }
+        if (lRead != 0)
+        {
+            std::cerr << "'" << pFile << "' is not a game record file of this kind" << std::endl;
+            return false;
+        }
+    }
+
+    mFile = fopen(pFile.c_str(), "wb");
+    mOk = mFile && fwrite(lHeader, cHeaderSize, 1, mFile) == 1;
+    if (!mOk)
+        std::cerr << "Cannot write game record file '" << pFile << "'" << std::endl;
+    return mOk;
+}
+
+void GameRecordWriter::write(const GameRecord &pGame)
+{
+    std::lock_guard<std::mutex> lLock(mMutex);
+    if (!mFile)
+        return;
+
+    std::size_t lCount = std::min<std::size_t>(pGame.mCells.size(), GameState::cSquares);
+    mBuffer.push_back((unsigned char)lCount);
+    mBuffer.insert(mBuffer.end(), pGame.mCells.begin(), pGame.mCells.begin() + lCount);
+    mBuffer.push_back(pGame.mResult);
+    if (mInfo)
+    {
+        std::size_t lAt = mBuffer.size();
+        mBuffer.resize(lAt + lCount * cInfoSize);
+        for (std::size_t i = 0; i < lCount; ++i)
+            putInfo(i < pGame.mInfo.size() ? pGame.mInfo[i] : MoveInfo(), &mBuffer[lAt + i * cInfoSize]);
+    }
+
+    if (mBuffer.size() >= cFlushSize)
+        flush();
+}
+
+void GameRecordWriter::flush()
+{
+    if (!mBuffer.empty())
+        mOk = fwrite(&mBuffer[0], mBuffer.size(), 1, mFile) == 1 && mOk;
+    mBuffer.clear();
+}
+
+bool GameRecordWriter::close()
+{
+    std::lock_guard<std::mutex> lLock(mMutex);
+    if (!mFile)
+        return mOk;
+    flush();
+    mOk = (fclose(mFile) == 0) && mOk;
+    mFile = 0;
+    return mOk;
+}
+
+MoveInfo RecordedGame::info(int pPly) const
+{
+    MoveInfo lInfo = MoveInfo();
+    if (!mInfo)
+        return lInfo;
+    const uint8_t *lIn = mInfo + pPly * cInfoSize;
+    uint32_t lScore = (uint32_t)lIn[0] | ((uint32_t)lIn[1] << 8) | ((uint32_t)lIn[2] << 16) | ((uint32_t)lIn[3] << 24);
+    memcpy(&lInfo.mScore, &lScore, sizeof(lScore));
+    lInfo.mDepth = (uint16_t)(lIn[4] | (lIn[5] << 8));
+    lInfo.mTime = (uint16_t)(lIn[6] | (lIn[7] << 8));
+    return lInfo;
+}
+
+GameRecordReader::GameRecordReader()
+    :   mMapping(0),
+        mSize(0),
+        mBegin(0),
+        mPosition(0),
+        mEnd(0),
+        mInfo(false),
+        mFailed(false)
+{
+}
+
+GameRecordReader::~GameRecordReader()
+{
+    release();
+}
+
+void GameRecordReader::release()
+{
+#ifndef _WIN32
+    if (mMapping)
+        munmap(mMapping, mSize);
+#endif
+    mMapping = 0;
+    mSize = 0;
+    std::vector<uint8_t>().swap(mCopy);
+    mBegin = mPosition = mEnd = 0;
+    mFailed = false;
+}
+
+bool GameRecordReader::open(const std::string &pFile)
+{
+    release();
+
+    const uint8_t *lData = 0;
+    std::size_t lSize = 0;
+#ifndef _WIN32
+    int lFd = ::open(pFile.c_str(), O_RDONLY);
+    if (lFd < 0)
+    {
+        std::cerr << "Cannot open game record file '" << pFile << "'" << std::endl;
+        return false;
+    }
+    struct stat lStat;
+    if (fstat(lFd, &lStat) == 0 && (std::size_t)lStat.st_size >= cHeaderSize)
+    {
+        void *lMapping = mmap(0, lStat.st_size, PROT_READ, MAP_SHARED, lFd, 0);
+        if (lMapping != MAP_FAILED)
+        {
+            mMapping = lMapping;
+            mSize = lStat.st_size;
+            lData = static_cast<const uint8_t *>(lMapping);
+            lSize = mSize;
+        }
+    }
+    close(lFd);
+#else
+    FILE *lFile = fopen(pFile.c_str(), "rb");
+    if (!lFile)
+    {
+        std::cerr << "Cannot open game record file '" << pFile << "'" << std::endl;
+        return false;
+    }
+    uint8_t lBlock[65536];
+    std::size_t lRead;
+    while ((lRead = fread(lBlock, 1, sizeof(lBlock), lFile)) > 0)
+        mCopy.insert(mCopy.end(), lBlock, lBlock + lRead);
+    fclose(lFile);
+    if (mCopy.size() >= cHeaderSize)
+    {
+        lData = &mCopy[0];
+        lSize = mCopy.size();
+    }
+#endif
+
+    if (!lData || memcmp(lData, cMagic, sizeof(cMagic)) != 0 || lData[8] != cVersion)
+    {
+        std::cerr << "'" << pFile << "' is not a game record file" << std::endl;
+        release();
+        return false;
+    }
+    mInfo = (lData[9] & cFlagInfo) != 0;
+    mBegin = mPosition = lData + cHeaderSize;
+    mEnd = lData + lSize;
+    return true;
+}
+
+bool GameRecordReader::next(RecordedGame &pGame)
+{
+    if (mEnd - mPosition < 2)
+        return false;
+    std::size_t lCount = mPosition[0];
+    std::size_t lSize = 2 + lCount + (mInfo ? lCount * cInfoSize : 0);
+    if ((std::size_t)(mEnd - mPosition) < lSize)
+        return false;
+
+    // The cells go straight into GameState::doMove, which trusts them
+    uint64_t lPlayed = 0;
+    bool lValid = mPosition[1 + lCount] <= GameRecord::RESULT_NONE;
+    for (std::size_t i = 0; i < lCount && lValid; ++i)
+    {
+        uint8_t lCell = mPosition[1 + i];
+        lValid = lCell < GameState::cSquares && !((lPlayed >> lCell) & 1);
+        lPlayed |= uint64_t(1) << lCell;
+    }
+    if (!lValid)
+    {
+        std::cerr << "Invalid game in the record file at byte " << (cHeaderSize + (mPosition - mBegin)) << std::endl;
+        mPosition = mEnd;
+        mFailed = true;
+        return false;
+    }
+
+    pGame.mCount = (int)lCount;
+    pGame.mCells = mPosition + 1;
+    pGame.mResult = mPosition[1 + lCount];
+    pGame.mInfo = mInfo ? mPosition + 2 + lCount : 0;
+    mPosition += lSize;
+    return true;
+}
+
+/*namespace TICTACTOE3D*/ }
@@ -0,0 +1,183 @@
+#ifndef _TICTACTOE3D_GAMERECORD_HPP_
+#define _TICTACTOE3D_GAMERECORD_HPP_
+
+#include "gamestate.hpp"
+#include <cstdio>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Search information kept for a move of a recorded game
+ *
+ * Moves that were not searched (openings, the opponent in a live game)
+ * have a depth of 0.
+ */
+struct MoveInfo
+{
+    float mScore;       ///< value of the move for the side that played it
+    uint16_t mDepth;    ///< depth searched
+    uint16_t mTime;     ///< time spent, in units of 100 microseconds
+};
+
+/**
+ * A game, as the cells played from the empty board and the result
+ */
+struct GameRecord
+{
+    enum Result
+    {
+        RESULT_DRAW = 0,
+        RESULT_X = 1,
+        RESULT_O = 2,
+        RESULT_NONE = 3     ///< the game was not finished
+    };
+
+    std::vector<uint8_t> mCells;
+    std::vector<MoveInfo> mInfo;    ///< one per cell, or empty
+    uint8_t mResult = RESULT_NONE;
+
+    ///starts the record with moves that lead to \p pPosition (X and O cells alternating)
+    void start(const GameState &pPosition);
+
+    ///adds the cell played to reach \p pState, and sets the result if the game is over
+    void add(const GameState &pState, const MoveInfo &pInfo = MoveInfo());
+};
+
+/**
+ * Files of recorded games
+ *
+ * A 16 byte header: the magic "TTT3GAME", a version byte and a flags byte
+ * (bit 0 set when moves carry a MoveInfo), then for every game
+ *
+ *     count (1 byte), count cells (1 byte each), result (1 byte),
+ *     and with MoveInfo, count times score (float), depth, time (uint16)
+ *
+ * all little endian.
+ */
+class GameRecordWriter
+{
+public:
+    explicit GameRecordWriter(bool pInfo = false);
+    ~GameRecordWriter();
+
+    GameRecordWriter(const GameRecordWriter &) = delete;
+    GameRecordWriter &operator=(const GameRecordWriter &) = delete;
+
+    ///opens \p pFile, appending to it if it already holds games of the same kind
+    bool open(const std::string &pFile);
+
+    ///adds a game, can be called from several threads
+    void write(const GameRecord &pGame);
+
+    ///writes out the buffered games and closes the file, returns false if anything failed
+    bool close();
+
+private:
+    void flush();
+
+    bool mInfo;
+    FILE *mFile;
+    bool mOk;
+    std::vector<unsigned char> mBuffer;
+    std::mutex mMutex;
+};
+
+/**
+ * A game inside a mapped record file
+ */
+struct RecordedGame
+{
+    const uint8_t *mCells;
+    int mCount;
+    uint8_t mResult;
+    const uint8_t *mInfo;       ///< packed MoveInfo, or null
+
+    ///decodes the search information of move \p pPly
+    MoveInfo info(int pPly) const;
+};
+
+/**
+ * Reads record files without copying them, by mapping them in memory
+ */
+class GameRecordReader
+{
+public:
+    GameRecordReader();
+    ~GameRecordReader();
+
+    GameRecordReader(const GameRecordReader &) = delete;
+    GameRecordReader &operator=(const GameRecordReader &) = delete;
+
+    bool open(const std::string &pFile);
+
+    ///true if the moves carry a MoveInfo
+    bool hasInfo() const        {   return mInfo;   }
+
+    ///points \p pGame at the next game, returns false at the end of the file, or at a game
+    ///that cannot be replayed (a cell off the board or played twice, an unknown result)
+    bool next(RecordedGame &pGame);
+
+    ///true once next() stopped at a game that cannot be replayed
+    bool failed() const         {   return mFailed; }
+
+    ///goes back to the first game
+    void rewind()               {   mPosition = mBegin; mFailed = false;    }
+
+private:
+    void release();
+
+    void *mMapping;
+    std::size_t mSize;
+    std::vector<uint8_t> mCopy;
+    const uint8_t *mBegin;
+    const uint8_t *mPosition;
+    const uint8_t *mEnd;
+    bool mInfo;
+    bool mFailed;
+};
+
+/**
+ * Steps through the positions of a recorded game
+ *
+ *     GameReplay lReplay(lGame);
+ *     while (lReplay.next())
+ *         use(lReplay.state());
+ */
+class GameReplay
+{
+public:
+    explicit GameReplay(const RecordedGame &pGame)
+        :   mGame(pGame),
+            mPly(0)
+    {
+    }
+
+    ///plays the next move, returns false when there are none left
+    bool next()
+    {
+        if (mPly >= mGame.mCount)
+            return false;
+        mState = GameState(mState, mState.moveTo(mGame.mCells[mPly++]));
+        return true;
+    }
+
+    ///the position after the moves played so far
+    const GameState &state() const  {   return mState;  }
+
+    ///the number of moves played so far
+    int ply() const                 {   return mPly;    }
+
+private:
+    RecordedGame mGame;
+    GameState mState;
+    int mPly;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -20,19 +20,43 @@ GameState::GameState()
 	mLastMove = Move(Move::MOVE_BOG);
 	// Player X starts
 	mNextPlayer = CELL_X;
+	mPieces[0] = mPieces[1] = 0;
+	// Every line is still open to both players
+	mOpen[0] = mOpen[1] = cLines.mAll;
+	mScore = Lines::cCount * cHeuristic[0][0];
 }
 
+namespace
+{
+
+///returns the first word of \p pText and removes it from \p pText
+std::string_view nextWord(std::string_view &pText)
+{
+	auto isSpace = [](char c) { return c == ' ' || (c >= '\t' && c <= '\r'); };
+	std::size_t lBegin = 0;
+	while (lBegin < pText.size() && isSpace(pText[lBegin]))
+		++lBegin;
+	std::size_t lEnd = lBegin;
+	while (lEnd < pText.size() && !isSpace(pText[lEnd]))
+		++lEnd;
+	std::string_view lWord = pText.substr(lBegin, lEnd - lBegin);
+	pText.remove_prefix(lEnd);
+	return lWord;
+}
+
+/*namespace*/ }
+
 /**
  * Constructs a board from a message string
  *
  * \param pMessage the compact string representation of the state
  */
-GameState::GameState(const std::string &pMessage)
+GameState::GameState(std::string_view pMessage)
 {	
-	// Split the message with a stringstream
-	std::stringstream ss(pMessage);
-	std::string board, last_move, next_player;
-	ss >> board >> last_move >> next_player;
+	// Split the message at the white space, as a stringstream would
+	std::string_view board = nextWord(pMessage);
+	std::string_view last_move = nextWord(pMessage);
+	std::string_view next_player = nextWord(pMessage);
 
 	assert(board.size() == (unsigned)cSquares);
 	assert(next_player.size() == 1);
@@ -50,15 +74,18 @@ GameState::GameState(const std::string &pMessage)
 			assert("Invalid cell" && false);
 	}
 
+	rebuild();
+
 	// Parse last move
 	mLastMove = Move(last_move);
 
 	// Parse next player
-	if (next_player[0] == MESSAGE_SYMBOLS[CELL_EMPTY])
+	char next = next_player.empty() ? '\0' : next_player[0];
+	if (next == MESSAGE_SYMBOLS[CELL_EMPTY])
 		mNextPlayer = CELL_EMPTY;
-	else if (next_player[0] == MESSAGE_SYMBOLS[CELL_X])
+	else if (next == MESSAGE_SYMBOLS[CELL_X])
 		mNextPlayer = CELL_X;
-	else if (next_player[0] == MESSAGE_SYMBOLS[CELL_O])
+	else if (next == MESSAGE_SYMBOLS[CELL_O])
 		mNextPlayer = CELL_O;
 	else
 	{
@@ -68,6 +95,49 @@ GameState::GameState(const std::string &pMessage)
 	}
 }
 
+bool GameState::hasMessageShape(std::string_view pMessage)
+{
+	auto isSymbol = [](char c) {
+		return c == MESSAGE_SYMBOLS[CELL_EMPTY] || c == MESSAGE_SYMBOLS[CELL_X] || c == MESSAGE_SYMBOLS[CELL_O];
+	};
+	std::size_t lBoardEnd = pMessage.find(' ');
+	if (lBoardEnd != (std::size_t)cSquares)
+		return false;
+	for (int i = 0; i < cSquares; ++i)
+		if (!isSymbol(pMessage[i]))
+			return false;
+	std::size_t lLast = pMessage.rfind(' ');
+	return lLast > lBoardEnd && lLast + 2 == pMessage.size() && isSymbol(pMessage[lLast + 1]);
+}
+
+GameState::GameState(uint64_t pX, uint64_t pO, const Move &pLastMove, uint8_t pNextPlayer)
+	:	mNextPlayer(pNextPlayer),
+		mLastMove(pLastMove)
+{
+	assert((pX & pO) == 0);
+	for (int i = 0; i < cSquares; ++i)
+		mCell[i] = ((pX >> i) & 1) ? CELL_X : ((pO >> i) & 1) ? CELL_O : CELL_EMPTY;
+	rebuild();
+}
+
+void GameState::rebuild()
+{
+	// Rebuild the bitboards and close the lines blocked by the pieces on the board
+	mPieces[0] = mPieces[1] = 0;
+	mOpen[0] = mOpen[1] = cLines.mAll;
+	for (int i = 0; i < cSquares; ++i)
+		if (mCell[i] != CELL_EMPTY)
+		{
+			mPieces[mCell[i] - 1] |= uint64_t(1) << i;
+			closeLines(i, mCell[i]);
+		}
+
+	// Score every line once, doMove keeps the sum up to date afterwards
+	mScore = 0;
+	for (int l = 0; l < Lines::cCount; ++l)
+		mScore += cHeuristic[popCount(mPieces[0] & cLines.mMask[l])][popCount(mPieces[1] & cLines.mMask[l])];
+}
+
 /**
  * Constructs a board which is the result of applying move \p pMove to board \p pRH
  *
@@ -84,6 +154,11 @@ GameState::GameState(const GameState &pRH,const Move &pMove)
     // Copy move status
     mNextPlayer     = pRH.mNextPlayer;
     mLastMove       = pRH.mLastMove;
+    mPieces[0]      = pRH.mPieces[0];
+    mPieces[1]      = pRH.mPieces[1];
+    mOpen[0]        = pRH.mOpen[0];
+    mOpen[1]        = pRH.mOpen[1];
+    mScore          = pRH.mScore;
 
     // Perform move
     doMove(pMove);
@@ -101,49 +176,23 @@ GameState::GameState(const GameState &pRH,const Move &pMove)
  */
 void GameState::tryMove(std::vector<Move> &pMoves, int pCell) const
 {
-    int lR=cellToRow(pCell);
-    int lC=cellToCol(pCell);
-	int lL=cellToLay(pCell);
-	int SpecialMove=0;
+	if(mNextPlayer!=CELL_X && mNextPlayer!=CELL_O)
+		return;
+
+	Cell lPlayer = Cell(mNextPlayer);
+	assert(at(pCell)==CELL_EMPTY);
+
+	//Check if special move
+	int SpecialMove = GameState::Special_Move(pCell,lPlayer);
 	
-    // Try move X
-    if(mNextPlayer==CELL_X)
-    {
-        // Try move
-        if(at(lR,lC,lL)==CELL_EMPTY)
-		{
-			//Check if special move
-			SpecialMove = GameState::Special_Move(pCell,CELL_X);
-			
-			if(SpecialMove>0)
-			{
-				pMoves.push_back(Move(pCell,CELL_X,SpecialMove));
-			}
-			else
-			{
-				pMoves.push_back(Move(pCell,CELL_X)); 
-			}
-		}                   
-    }
-    // Try move O
-    if(mNextPlayer==CELL_O)
-    {
-        // Try move
-        if(at(lR,lC,lL)==CELL_EMPTY)
-		{
-			//Check if special move
-			SpecialMove = GameState::Special_Move(pCell,CELL_O);
-			
-			if(SpecialMove>0)
-			{
-				pMoves.push_back(Move(pCell,CELL_O,SpecialMove));
-			}
-			else
-			{
-				pMoves.push_back(Move(pCell,CELL_O)); 
-			}
-		}                  
-    }
+	if(SpecialMove>0)
+	{
+		pMoves.push_back(Move(pCell,lPlayer,SpecialMove));
+	}
+	else
+	{
+		pMoves.push_back(Move(pCell,lPlayer)); 
+	}
 }
 
 
@@ -161,14 +210,17 @@ void GameState::findPossibleMoves(std::vector<GameState> &pStates) const
     if (mLastMove.isEOG())
     	return;
 
-	std::vector<Move> lMoves;
+    std::vector<Move> lMoves;
 	
-    for (int k = 0; k < cSquares; ++k)
+    // Only the empty cells can be played
+    uint64_t lEmpty = ~(mPieces[0] | mPieces[1]);
+    while (lEmpty)
     {
-        int lCell = k;       
-        tryMove(lMoves, lCell);		
-    }   
-	
+        int lCell = lowestBit(lEmpty);
+        lEmpty &= lEmpty - 1;
+        tryMove(lMoves, lCell);
+    }
+
     // Convert moves to GameStates
     for (unsigned i = 0; i < lMoves.size(); ++i)
     	pStates.push_back(GameState(*this, lMoves[i]));	
@@ -184,10 +236,24 @@ void GameState::findPossibleMoves(std::vector<GameState> &pStates) const
  */
 void GameState::doMove(const Move &pMove)
 {
-   
-   // set the piece
-		at(pMove[0]) = pMove[1];
-    
+    int lCell = pMove[0];
+    int lWho = pMove[1] - 1;
+
+    // Only the lines through the cell change value
+    for (int i = 0; i < cLines.mCellCount[lCell]; ++i)
+    {
+        uint64_t lMask = cLines.mMask[cLines.mCellLines[lCell][i]];
+        int lCount[2] = { popCount(mPieces[0] & lMask), popCount(mPieces[1] & lMask) };
+        mScore -= cHeuristic[lCount[0]][lCount[1]];
+        ++lCount[lWho];
+        mScore += cHeuristic[lCount[0]][lCount[1]];
+    }
+
+    // Set the piece
+    at(lCell) = pMove[1];
+    mPieces[lWho] |= uint64_t(1) << lCell;
+    closeLines(lCell, pMove[1]);
+
     // Remember last move
     mLastMove = pMove;
 
@@ -245,18 +311,23 @@ std::string GameState::toString(int pPlayer) const
  */
 std::string GameState::toMessage() const
 {
-	// Use a stringstream to compose the message
-	std::stringstream ss;
+	char lBuffer[cMaxMessage];
+	return std::string(lBuffer, format(lBuffer));
+}
 
+char *GameState::format(char *pBuffer) const
+{
 	// The board goes first
-    for(int i=0;i<cSquares;i++)
-		ss << MESSAGE_SYMBOLS[mCell[i]];
-
-    // Then the information about moves
-    assert(mNextPlayer == CELL_O || mNextPlayer == CELL_X);
-    ss << " " << mLastMove.toMessage() << " " << MESSAGE_SYMBOLS[mNextPlayer] ;
-
-	return ss.str();
+	for(int i=0;i<cSquares;i++)
+		*pBuffer++ = MESSAGE_SYMBOLS[mCell[i]];
+
+	// Then the information about moves
+	assert(mNextPlayer == CELL_O || mNextPlayer == CELL_X);
+	*pBuffer++ = ' ';
+	pBuffer = mLastMove.format(pBuffer);
+	*pBuffer++ = ' ';
+	*pBuffer++ = MESSAGE_SYMBOLS[mNextPlayer];
+	return pBuffer;
 }
 
 /*namespace TICTACTOE3D*/ }
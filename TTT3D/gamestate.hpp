@@ -3,15 +3,28 @@
 
 #include "constants.hpp"
 #include "move.hpp"
+#include "lines.hpp"
 #include <stdint.h>
 #include <cassert>
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 namespace TICTACTOE3D
 {
 
+/**
+ * Value of a winning line holding [number of X][number of O] pieces,
+ * seen from X. Lines holding pieces of both players are worth nothing.
+ */
+constexpr int cHeuristic[5][5] = {
+	{      1,   -10,  -100, -1000, -10000 },
+	{     10,     0,     0,     0, 0      },
+	{    100,     0,     0,     0, 0      },
+	{   1000,     0,     0,     0, 0      },
+	{  10000,     0,     0,     0, 0      } };
+
 /**
  * Represents a game state with a 4x4 board
  *
@@ -55,7 +68,25 @@ public:
 	 *
 	 * \param pMessage the compact string representation of the state
 	 */
-	GameState(const std::string &pMessage);
+	GameState(std::string_view pMessage);
+
+	/**
+	 * Returns true if \p pMessage has a board and a next player where the
+	 * constructor above looks for them (it asserts on anything else). A
+	 * message read from outside is a state if this holds and the state
+	 * reads back to the same message.
+	 */
+	static bool hasMessageShape(std::string_view pMessage);
+
+	/**
+	 * Constructs a board from its bitboards, as carried by the binary protocol
+	 *
+	 * \param pX the cells held by X
+	 * \param pO the cells held by O, none of them in \p pX
+	 * \param pLastMove the move that lead to the state
+	 * \param pNextPlayer CELL_X or CELL_O
+	 */
+	GameState(uint64_t pX, uint64_t pO, const Move &pLastMove, uint8_t pNextPlayer);
 
 	/**
 	 * Constructs a board which is the result of applying move \p pMove to board \p pRH
@@ -135,20 +166,19 @@ public:
 	///returns the row corresponding to a cell index
 	static int cellToRow(int pCell)
 	{
-		return (((pCell) >> 2)-(4*cellToLay(pCell)));
+		return cLines.mRow[pCell];
 	}
 
 	///returns the col corresponding to a cell index
 	static int cellToCol(int pCell)
 	{
-		int lC = ((pCell) & 3);
-		return lC;
+		return cLines.mCol[pCell];
 	}
 	
 	///returns the lay corresponding to a cell index
 	static int cellToLay(int pCell)
 	{
-		return pCell/16;
+		return cLines.mLay[pCell];
 	}
 
 	///returns the cell corresponding to a row and col
@@ -174,6 +204,25 @@ private:
 	 * who is not making the move
 	 */
 	void tryMove(std::vector<Move> &pMoves, int pCell) const;
+
+	///sets the bitboards, open lines and score from mCell
+	void rebuild();
+
+	///marks the lines through \p pCell as lost for the opponent of \p pPlayer
+	void closeLines(int pCell, uint8_t pPlayer)
+	{
+		mOpen[(pPlayer ^ (CELL_X | CELL_O)) - 1].remove(cLines.mCellSet[pCell]);
+	}
+
+	///returns true if no line is winnable by either player after \p pPlayer plays \p pCell
+	bool isDeadAfter(int pCell, Cell pPlayer) const
+	{
+		const LineSet &lOwn = mOpen[pPlayer - 1];
+		const LineSet &lOther = mOpen[(pPlayer ^ (CELL_X | CELL_O)) - 1];
+		const LineSet &lCell = cLines.mCellSet[pCell];
+		return ((lOwn.mBits[0] | (lOther.mBits[0] & ~lCell.mBits[0])) |
+				(lOwn.mBits[1] | (lOther.mBits[1] & ~lCell.mBits[1]))) == 0;
+	}
 	
 	
 private:
@@ -187,106 +236,17 @@ private:
 	
 	int Special_Move(int pCell, Cell pPlayer) const
 	{
-		int lR=cellToRow(pCell)+1;
-		int lC=cellToCol(pCell)+1;
-		int lL=cellToLay(pCell)+1;
-		//check if winning move:
-		int checkWin3D[6][6][6];
-		//fill check 3D array
-		for (int x=0;x<4;x++) {
-			 for (int y=0;y<4;y++) {
-				 for (int z=0;z<4;z++) {
-					 checkWin3D[x+1][y+1][z+1]=at(x,y,z);
-					 }
-				 }
-         } 
-
-		 for (int i=0;i<6;i++) {
-			 for (int j=0;j<6;j++) {
-				 checkWin3D[0][i][j]=7; checkWin3D[5][i][j]=7;
-				 checkWin3D[i][j][0]=7; checkWin3D[i][j][5]=7;
-				 checkWin3D[i][0][j]=7; checkWin3D[i][5][j]=7;}
-		} 
-		
-		 //make the move temporaly:
-		checkWin3D[lR][lC][lL]=pPlayer;
-		
-		int x[4],y[4],z[4];        //variables to store winning coordinates
-		x[0]=lR;y[0]=lC;z[0]=lL;   //sets 0 of each to last move
-     
-		int Pcount;
-     
-     for (int a=1;a<14;a++){    //iterates through all possible directions in 3D space     
-           Pcount=1;                      //reset counter     
-           int lR2=lR; int lC2=lC; int lL2=lL;
-           
-           for (;checkWin3D[lR2][lC2][lL2]!=7;){
-			
-				//look in every derection until out of field ('7')
-                switch (a) {
-					case 1:lR2--;break;                
-					case 2:lR2--;lC2--;lL2--;break;    
-					case 3:lR2--;lC2--;break;          
-					case 4:lR2--;lC2--;lL2++;break;    
-					case 5:lR2--;lL2--;break;          
-					case 6:lR2--;lL2++;break;          
-					case 7:lR2--;lC2++;lL2--;break;    
-					case 8:lR2--;lC2++;break;          
-					case 9:lR2--;lC2++;lL2++;break;    
-					case 10:lL2--;break;               
-					case 11:lC2--;lL2--;break;         
-					case 12:lC2--;break;               
-					case 13:lC2--;lL2++;break;         
-                }                        
-                if (checkWin3D[lR2][lC2][lL2]==pPlayer) {
-                           x[Pcount]=lR2;y[Pcount]=lC2;z[Pcount]=lL2;
-                           Pcount++;}
-                 
-            }                 
-            
-			lR2=lR;lC2=lC;lL2=lL;   //reset placeholder variables
-         
-         
-			for (;checkWin3D[lR2][lC2][lL2]!=7;) { 
-              
-              
-				switch (a) {
-					case 1:lR2++;break;                ///////////////////////
-					case 2:lR2++;lC2++;lL2++;break;      //
-					case 3:lR2++;lC2++;break;           // and
-					case 4:lR2++;lC2++;lL2--;break;      // then back
-					case 5:lR2++;lL2++;break;           //  in the
-					case 6:lR2++;lL2--;break;           //  opposite 
-					case 7:lR2++;lC2--;lL2++;break;      //  direction
-					case 8:lR2++;lC2--;break;           //
-					case 9:lR2++;lC2--;lL2--;break;      //
-					case 10:lL2++;break;               //
-					case 11:lC2++;lL2++;break;          //
-					case 12:lC2++;break;               //
-					case 13:lC2++;lL2--;break;          ///////////////////////
-                }
-                                   
-				if (checkWin3D[lR2][lC2][lL2]==pPlayer) {
-                      x[Pcount]=lR2;y[Pcount]=lC2;z[Pcount]=lL2;
-                      Pcount++;
-                }
-            }
-			   
-            if (Pcount>3) {for (int b=0;b<4;b++) {checkWin3D[x[b]][y[b]][z[b]]=4;} 
-			return 1;}
-        }
-		//Check Draw 
-		int cpieces=0;
-		for (int k = 0; k < cSquares; ++k)
-			{
-				// Try move
-				if(at(k)!=CELL_EMPTY)
-				{
-					cpieces+=1;
-				}
-			}
-			
-		if(cpieces==cSquares-1 )
+		//check if winning move: one of the lines through the cell gets filled
+		uint64_t lPieces = mPieces[pPlayer - 1] | (uint64_t(1) << pCell);
+		for (int i = 0; i < cLines.mCellCount[pCell]; ++i)
+		{
+			uint64_t lMask = cLines.mMask[cLines.mCellLines[pCell][i]];
+			if ((lPieces & lMask) == lMask)
+				return 1;
+		}
+
+		//Check Draw: no line is left that either player can still complete
+		if(isDeadAfter(pCell,pPlayer))
 			return 2;
 		
 		return 0;
@@ -302,6 +262,19 @@ public:
 	 */
 	void findPossibleMoves(std::vector<GameState> &pMoves) const;
 
+	/**
+	 * Returns the move of the next player to the empty cell \p pCell
+	 *
+	 * The move is marked as a win or a draw when it ends the game, as the
+	 * moves returned by findPossibleMoves are.
+	 */
+	Move moveTo(int pCell) const
+	{
+		Cell lPlayer = Cell(mNextPlayer);
+		int lSpecial = Special_Move(pCell, lPlayer);
+		return (lSpecial > 0) ? Move(pCell, lPlayer, lSpecial) : Move(pCell, lPlayer);
+	}
+
 	/**
 	 * Transforms the board by performing a move
 	 *
@@ -316,17 +289,33 @@ public:
 	 *
 	 * \param gameState game state to compare to
 	 */
-	bool isEqual(GameState gameState)
+	bool isEqual(const GameState &gameState) const
+	{
+		// The bitboards mirror the cells
+		return mPieces[0] == gameState.mPieces[0] && mPieces[1] == gameState.mPieces[1] &&
+			   mNextPlayer == gameState.mNextPlayer && mLastMove == gameState.mLastMove;
+	}
+
+	/**
+	 * Checks that \p pNext follows from this state by one legal move, as a state
+	 * from findPossibleMoves would, without generating the moves
+	 *
+	 * The next player must have put exactly one stone on an empty cell, the
+	 * other player's stones must be unchanged, the turn must have passed and
+	 * the last move must be that stone with the right win or draw mark.
+	 * The check takes the same few operations whatever the position.
+	 */
+	bool isLegalSuccessor(const GameState &pNext) const
 	{
-		bool equal = true;
-		for (int i = 0; i < cSquares; ++i)
-			if (mCell[i] != gameState.at(i))
-				equal = false;
-		if (mNextPlayer != gameState.getNextPlayer())
-			equal = false;
-		if (mLastMove.toMessage().compare(gameState.getMove().toMessage()) != 0)
-			equal = false;
-		return equal;
+		if (isEOG() || (mNextPlayer != CELL_X && mNextPlayer != CELL_O))
+			return false;
+		int lOwn = mNextPlayer - 1;
+		uint64_t lAdded = pNext.mPieces[lOwn] & ~mPieces[lOwn];
+		if (lAdded == 0 || (lAdded & (lAdded - 1)) != 0 || (lAdded & mPieces[lOwn ^ 1]) != 0 ||
+			pNext.mPieces[lOwn] != (mPieces[lOwn] | lAdded) || pNext.mPieces[lOwn ^ 1] != mPieces[lOwn ^ 1] ||
+			pNext.mNextPlayer != (mNextPlayer ^ (CELL_X | CELL_O)))
+			return false;
+		return pNext.mLastMove == moveTo(lowestBit(lAdded));
 	}
 
 	/**
@@ -343,6 +332,17 @@ public:
 	 */
 	std::string toMessage() const;
 
+	/// Longest message of a state
+	static const int cMaxMessage = cSquares + Move::cMaxMessage + 4;
+
+	/**
+	 * Writes toMessage() to \p pBuffer without allocating
+	 *
+	 * \param pBuffer room for at least cMaxMessage characters
+	 * \return the end of the message (it is not terminated)
+	 */
+	char *format(char *pBuffer) const;
+
 	/**
 	 * Get the last move made (the move that lead to this state)
 	 */
@@ -356,6 +356,30 @@ public:
 		return mNextPlayer;
 	}
 
+	/// returns the cells occupied by \p pPlayer as a bitboard (bit i is cell i)
+	uint64_t getPieces(uint8_t pPlayer) const
+	{
+		return mPieces[pPlayer - 1];
+	}
+
+	/// returns true if \p pPlayer can still complete at least one line
+	bool canWin(uint8_t pPlayer) const
+	{
+		return !mOpen[pPlayer - 1].empty();
+	}
+
+	/// returns true if neither player can complete a line any more
+	bool isDead() const
+	{
+		return !canWin(CELL_X) && !canWin(CELL_O);
+	}
+
+	/// returns the sum of cHeuristic over all lines, kept up to date by doMove
+	int getScore() const
+	{
+		return mScore;
+	}
+
 	/// returns true if the movement marks beginning of game
 	bool isBOG() const
 	{
@@ -386,6 +410,9 @@ private:
 	uint8_t mCell[cSquares];
 	uint8_t mNextPlayer;
 	Move mLastMove;
+	uint64_t mPieces[2];	// cells held by X ([0]) and O ([1]), mirrors mCell
+	LineSet mOpen[2];		// lines still winnable by X ([0]) and O ([1])
+	int mScore;				// sum of cHeuristic over all lines
 };
 
 /*namespace TICTACTOE3D*/}
@@ -0,0 +1,189 @@
+#include "lineeval.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define TTT_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace TICTACTOE3D
+{
+
+namespace
+{
+
+// The kernels walk the line masks in blocks of 8, so the table is padded
+// with empty masks. Each padding line counts as an empty line.
+const int cPadded = 80;
+const int cPadding = cPadded - Lines::cCount;
+
+struct Tables
+{
+    alignas(64) uint64_t mMask[cPadded];    ///< line masks, zero padded
+    alignas(64) long long mValue[25];       ///< cHeuristic indexed by num_x * 5 + num_o
+};
+
+constexpr Tables makeTables()
+{
+    Tables lTables{};
+    for (int l = 0; l < Lines::cCount; ++l)
+        lTables.mMask[l] = cLines.mMask[l];
+    for (int x = 0; x < 5; ++x)
+        for (int o = 0; o < 5; ++o)
+            lTables.mValue[x * 5 + o] = cHeuristic[x][o];
+    return lTables;
+}
+
+constexpr Tables cTables = makeTables();
+
+int evaluateScalar(uint64_t pX, uint64_t pO)
+{
+    int lScore = 0;
+    for (int l = 0; l < Lines::cCount; ++l)
+        lScore += cHeuristic[popCount(pX & cLines.mMask[l])][popCount(pO & cLines.mMask[l])];
+    return lScore;
+}
+
+#ifdef TTT_X86_KERNELS
+
+///per 64-bit lane popcount: look up the bits of every nibble and add the bytes up
+__attribute__((target("sse4.2")))
+inline __m128i popCount128(__m128i pBits)
+{
+    const __m128i lNibbles = _mm_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m128i lLow = _mm_set1_epi8(0x0f);
+    __m128i lCount = _mm_add_epi8(_mm_shuffle_epi8(lNibbles, _mm_and_si128(pBits, lLow)),
+                                  _mm_shuffle_epi8(lNibbles, _mm_and_si128(_mm_srli_epi16(pBits, 4), lLow)));
+    return _mm_sad_epu8(lCount, _mm_setzero_si128());
+}
+
+__attribute__((target("sse4.2")))
+int evaluateSse42(uint64_t pX, uint64_t pO)
+{
+    const __m128i lX = _mm_set1_epi64x(pX);
+    const __m128i lO = _mm_set1_epi64x(pO);
+    long long lScore = 0;
+    for (int l = 0; l < cPadded; l += 2)
+    {
+        __m128i lMask = _mm_load_si128((const __m128i *)&cTables.mMask[l]);
+        __m128i lNumX = popCount128(_mm_and_si128(lX, lMask));
+        __m128i lNumO = popCount128(_mm_and_si128(lO, lMask));
+        __m128i lIndex = _mm_add_epi64(_mm_add_epi64(_mm_slli_epi64(lNumX, 2), lNumX), lNumO);
+        lScore += cTables.mValue[_mm_cvtsi128_si64(lIndex)] + cTables.mValue[_mm_extract_epi64(lIndex, 1)];
+    }
+    return (int)(lScore - cPadding * cHeuristic[0][0]);
+}
+
+__attribute__((target("avx2")))
+inline __m256i popCount256(__m256i pBits)
+{
+    const __m256i lNibbles = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                              0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i lLow = _mm256_set1_epi8(0x0f);
+    __m256i lCount = _mm256_add_epi8(_mm256_shuffle_epi8(lNibbles, _mm256_and_si256(pBits, lLow)),
+                                     _mm256_shuffle_epi8(lNibbles, _mm256_and_si256(_mm256_srli_epi16(pBits, 4), lLow)));
+    return _mm256_sad_epu8(lCount, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+int evaluateAvx2(uint64_t pX, uint64_t pO)
+{
+    const __m256i lX = _mm256_set1_epi64x(pX);
+    const __m256i lO = _mm256_set1_epi64x(pO);
+    __m256i lSum = _mm256_setzero_si256();
+    for (int l = 0; l < cPadded; l += 4)
+    {
+        __m256i lMask = _mm256_load_si256((const __m256i *)&cTables.mMask[l]);
+        __m256i lNumX = popCount256(_mm256_and_si256(lX, lMask));
+        __m256i lNumO = popCount256(_mm256_and_si256(lO, lMask));
+        __m256i lIndex = _mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(lNumX, 2), lNumX), lNumO);
+        lSum = _mm256_add_epi64(lSum, _mm256_i64gather_epi64(cTables.mValue, lIndex, 8));
+    }
+    __m128i lHalf = _mm_add_epi64(_mm256_castsi256_si128(lSum), _mm256_extracti128_si256(lSum, 1));
+    long long lScore = _mm_cvtsi128_si64(lHalf) + _mm_extract_epi64(lHalf, 1);
+    return (int)(lScore - cPadding * cHeuristic[0][0]);
+}
+
+// The zero-masked forms and the sum over memory do what _mm512_slli_epi64, the gather and
+// _mm512_reduce_add_epi64 do, without the undefined vectors GCC 12 warns about in those
+__attribute__((target("avx512f,avx512vpopcntdq")))
+int evaluateAvx512(uint64_t pX, uint64_t pO)
+{
+    const __m512i lX = _mm512_set1_epi64(pX);
+    const __m512i lO = _mm512_set1_epi64(pO);
+    __m512i lSum = _mm512_setzero_si512();
+    for (int l = 0; l < cPadded; l += 8)
+    {
+        __m512i lMask = _mm512_load_si512((const void *)&cTables.mMask[l]);
+        __m512i lNumX = _mm512_popcnt_epi64(_mm512_and_si512(lX, lMask));
+        __m512i lNumO = _mm512_popcnt_epi64(_mm512_and_si512(lO, lMask));
+        __m512i lIndex = _mm512_add_epi64(_mm512_add_epi64(_mm512_maskz_slli_epi64(0xff, lNumX, 2), lNumX), lNumO);
+        lSum = _mm512_add_epi64(lSum, _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), 0xff, lIndex,
+                                                                  cTables.mValue, 8));
+    }
+    alignas(64) long long lLanes[8];
+    _mm512_store_si512((void *)lLanes, lSum);
+    long long lScore = 0;
+    for (int i = 0; i < 8; ++i)
+        lScore += lLanes[i];
+    return (int)(lScore - cPadding * cHeuristic[0][0]);
+}
+
+#endif
+
+/*namespace*/ }
+
+LineEvaluator::LineEvaluator(Kernel pKernel)
+    :   mKernel(pKernel),
+        mFunction(evaluateScalar)
+{
+    assert(isSupported(pKernel));
+#ifdef TTT_X86_KERNELS
+    if (pKernel == KERNEL_SSE42)
+        mFunction = evaluateSse42;
+    else if (pKernel == KERNEL_AVX2)
+        mFunction = evaluateAvx2;
+    else if (pKernel == KERNEL_AVX512)
+        mFunction = evaluateAvx512;
+#endif
+}
+
+LineEvaluator::Kernel LineEvaluator::bestKernel()
+{
+    static const Kernel lBest = []()
+    {
+        for (int k = KERNEL_AVX512; k > KERNEL_SCALAR; --k)
+            if (isSupported(Kernel(k)))
+                return Kernel(k);
+        return KERNEL_SCALAR;
+    }();
+    return lBest;
+}
+
+bool LineEvaluator::isSupported(Kernel pKernel)
+{
+#ifdef TTT_X86_KERNELS
+    __builtin_cpu_init();
+    switch (pKernel)
+    {
+    case KERNEL_SCALAR:
+        return true;
+    case KERNEL_SSE42:
+        return __builtin_cpu_supports("sse4.2");
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case KERNEL_AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+    }
+    return false;
+#else
+    return pKernel == KERNEL_SCALAR;
+#endif
+}
+
+const char *LineEvaluator::kernelName(Kernel pKernel)
+{
+    static const char *cNames[4] = { "scalar", "sse4.2", "avx2", "avx512" };
+    return cNames[pKernel];
+}
+
+/*namespace TICTACTOE3D*/ }
@@ -0,0 +1,66 @@
+#ifndef _TICTACTOE3D_LINEEVAL_HPP_
+#define _TICTACTOE3D_LINEEVAL_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Scores a position from scratch, without the help of the running score
+ * kept by GameState
+ *
+ * The score is the same as GameState::getScore(): the sum of cHeuristic
+ * over the 76 lines. All lines are tested against both bitboards at once
+ * with the widest vector unit the CPU offers, picked when the program runs.
+ *
+ * Use it where a state must be scored on its own (checking the running
+ * score, analysing positions loaded from a file).
+ */
+class LineEvaluator
+{
+public:
+    enum Kernel
+    {
+        KERNEL_SCALAR=0,    ///< one line at a time, runs everywhere
+        KERNEL_SSE42=1,     ///< two lines per instruction
+        KERNEL_AVX2=2,      ///< four lines per instruction
+        KERNEL_AVX512=3     ///< eight lines per instruction, needs VPOPCNTDQ
+    };
+
+    ///uses kernel \p pKernel, which must be supported by this CPU
+    explicit LineEvaluator(Kernel pKernel=bestKernel());
+
+    ///returns the fastest kernel this CPU supports
+    static Kernel bestKernel();
+
+    ///returns true if this CPU can run kernel \p pKernel
+    static bool isSupported(Kernel pKernel);
+
+    ///returns a printable name for \p pKernel
+    static const char *kernelName(Kernel pKernel);
+
+    ///returns the kernel in use
+    Kernel getKernel() const    {    return mKernel;    }
+
+    ///scores the position with X on \p pX and O on \p pO
+    int evaluate(uint64_t pX, uint64_t pO) const
+    {
+        return mFunction(pX, pO);
+    }
+
+    ///scores \p pState
+    int evaluate(const GameState &pState) const
+    {
+        return mFunction(pState.getPieces(CELL_X), pState.getPieces(CELL_O));
+    }
+
+private:
+    Kernel mKernel;
+    int (*mFunction)(uint64_t, uint64_t);
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
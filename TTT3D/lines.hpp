@@ -0,0 +1,159 @@
+#ifndef _TICTACTOE3D_LINES_HPP_
+#define _TICTACTOE3D_LINES_HPP_
+
+#include <stdint.h>
+
+namespace TICTACTOE3D
+{
+
+///returns the number of bits set in \p pBits
+inline int popCount(uint64_t pBits)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(pBits);
+#else
+    pBits = pBits - ((pBits >> 1) & 0x5555555555555555ULL);
+    pBits = (pBits & 0x3333333333333333ULL) + ((pBits >> 2) & 0x3333333333333333ULL);
+    pBits = (pBits + (pBits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((pBits * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+///returns the index of the lowest bit set in \p pBits, which must not be 0
+inline int lowestBit(uint64_t pBits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(pBits);
+#else
+    int lBit = 0;
+    while (!(pBits & 1))
+    {
+        pBits >>= 1;
+        ++lBit;
+    }
+    return lBit;
+#endif
+}
+
+/**
+ * A set of winning lines, one bit per line
+ */
+struct LineSet
+{
+    uint64_t mBits[2];
+
+    ///adds line \p pLine to the set
+    constexpr void add(int pLine)
+    {
+        mBits[pLine >> 6] |= uint64_t(1) << (pLine & 63);
+    }
+
+    ///removes every line of \p pRH from the set
+    void remove(const LineSet &pRH)
+    {
+        mBits[0] &= ~pRH.mBits[0];
+        mBits[1] &= ~pRH.mBits[1];
+    }
+
+    ///returns true if the set holds no line
+    bool empty() const
+    {
+        return (mBits[0] | mBits[1]) == 0;
+    }
+};
+
+/**
+ * Geometry of the 4x4x4 board
+ *
+ * Everything here is computed at compile time by makeLines(), so the
+ * move generator, the win detection and the evaluation all share the
+ * same numbering of the 76 winning lines.
+ *
+ * Lines are numbered by direction: the 48 rows, columns and pillars come
+ * first (lines 0 to 47), then the 24 diagonals lying in a plane (48 to 71)
+ * and finally the 4 space diagonals (72 to 75).
+ */
+struct Lines
+{
+    static const int cCells = 64;       ///< cells on the board
+    static const int cCount = 76;       ///< winning lines on the board
+    static const int cMaxPerCell = 7;   ///< most lines passing through one cell
+
+    uint8_t mCells[cCount][4];              ///< cells of each line, in increasing order
+    uint64_t mMask[cCount];                 ///< cells of each line as a bitboard
+    uint8_t mCellCount[cCells];             ///< number of lines through each cell
+    uint8_t mCellLines[cCells][cMaxPerCell];///< lines through each cell
+    LineSet mCellSet[cCells];               ///< lines through each cell, as a set
+    LineSet mAll;                           ///< every line of the board
+    uint8_t mRow[cCells];                   ///< row of each cell
+    uint8_t mCol[cCells];                   ///< column of each cell
+    uint8_t mLay[cCells];                   ///< layer of each cell
+};
+
+///builds the line tables by walking the 13 directions of the cube from every cell
+constexpr Lines makeLines()
+{
+    const int lDirs[13][3] = {
+        {1,0,0}, {0,1,0}, {0,0,1},
+        {1,1,0}, {1,-1,0}, {1,0,1}, {1,0,-1}, {0,1,1}, {0,1,-1},
+        {1,1,1}, {1,1,-1}, {1,-1,1}, {1,-1,-1} };
+
+    Lines lLines{};
+    for (int k = 0; k < Lines::cCells; ++k)
+    {
+        lLines.mRow[k] = (k >> 2) & 3;
+        lLines.mCol[k] = k & 3;
+        lLines.mLay[k] = k >> 4;
+    }
+
+    int lLine = 0;
+    for (int d = 0; d < 13; ++d)
+    {
+        for (int k = 0; k < Lines::cCells; ++k)
+        {
+            int lR = lLines.mRow[k], lC = lLines.mCol[k], lL = lLines.mLay[k];
+            int lEndR = lR + 3 * lDirs[d][0];
+            int lEndC = lC + 3 * lDirs[d][1];
+            int lEndL = lL + 3 * lDirs[d][2];
+            if (lEndR < 0 || lEndR > 3 || lEndC < 0 || lEndC > 3 || lEndL < 0 || lEndL > 3)
+                continue;
+
+            uint8_t lCells[4] = {};
+            for (int i = 0; i < 4; ++i)
+                lCells[i] = (lR + i * lDirs[d][0]) * 4 + (lC + i * lDirs[d][1]) + 16 * (lL + i * lDirs[d][2]);
+
+            // Keep the cells sorted so that they match the bit order of the mask
+            for (int i = 1; i < 4; ++i)
+                for (int j = i; j > 0 && lCells[j - 1] > lCells[j]; --j)
+                {
+                    uint8_t lTmp = lCells[j];
+                    lCells[j] = lCells[j - 1];
+                    lCells[j - 1] = lTmp;
+                }
+
+            for (int i = 0; i < 4; ++i)
+            {
+                int lCell = lCells[i];
+                lLines.mCells[lLine][i] = lCell;
+                lLines.mMask[lLine] |= uint64_t(1) << lCell;
+                lLines.mCellLines[lCell][lLines.mCellCount[lCell]++] = lLine;
+                lLines.mCellSet[lCell].add(lLine);
+            }
+            lLines.mAll.add(lLine);
+            ++lLine;
+        }
+    }
+    return lLines;
+}
+
+///the line tables of the board
+inline constexpr Lines cLines = makeLines();
+
+static_assert(cLines.mMask[Lines::cCount - 1] != 0, "line table is incomplete");
+static_assert(cLines.mCellCount[0] == Lines::cMaxPerCell, "corner cells lie on 7 lines");
+static_assert(cLines.mCellCount[21] == Lines::cMaxPerCell, "inner cells lie on 7 lines");
+static_assert(cLines.mCellCount[1] == 4, "edge cells lie on 4 lines");
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
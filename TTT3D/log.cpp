@@ -0,0 +1,336 @@
+#include "log.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace TICTACTOE3D
+{
+
+static_assert(std::is_trivially_copyable<GameState>::value, "boards are logged by copying their bytes");
+
+std::atomic<int> Log::sLevel(-1);
+
+namespace
+{
+
+///the messages of one thread
+struct Ring
+{
+    LogRecord mRecords[Log::cCapacity];
+    std::atomic<uint64_t> mHead;        ///< records ever committed
+    std::atomic<uint64_t> mTail;        ///< records ever written out
+    std::atomic<uint64_t> mDropped;
+    uint64_t mReported;                 ///< drops already reported, writer only
+    double mTokens;                     ///< messages that may still be logged, owner only
+    std::chrono::steady_clock::time_point mRefill;
+};
+
+// The rings outlive their threads so that their last messages still get written
+std::mutex sMutex;
+std::vector<std::unique_ptr<Ring> > sRings;
+thread_local Ring *tRing = nullptr;
+
+std::thread sWriter;
+std::atomic<bool> sStop(false);
+std::atomic<double> sRate(10000);
+int sFd = 2;
+int sWanted = LOG_INFO;
+
+// The writer sleeps on sWake while there is nothing to write; the first message after it
+// went to sleep wakes it, those that come before it is up are written with that one
+std::mutex sWakeMutex;
+std::condition_variable sWake;
+std::atomic<bool> sSleeping(false);
+
+///wakes the writer if it sleeps
+void wake()
+{
+    // Pairs with the fence in run(): either the writer sees what was committed before
+    // this, or this sees that it sleeps
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sSleeping.load(std::memory_order_relaxed) && sSleeping.exchange(false))
+    {
+        std::lock_guard<std::mutex> lLock(sWakeMutex);
+        sWake.notify_one();
+    }
+}
+
+Ring &ring()
+{
+    if (!tRing)
+    {
+        std::unique_ptr<Ring> lRing(new Ring);
+        lRing->mHead = 0;
+        lRing->mTail = 0;
+        lRing->mDropped = 0;
+        lRing->mReported = 0;
+        lRing->mTokens = Log::cCapacity;
+        lRing->mRefill = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lLock(sMutex);
+        tRing = lRing.get();
+        sRings.push_back(std::move(lRing));
+    }
+    return *tRing;
+}
+
+void writeAll(const std::string &pText)
+{
+    std::size_t lDone = 0;
+    while (lDone < pText.size())
+    {
+#ifdef _WIN32
+        int lWritten = _write(sFd, pText.data() + lDone, pText.size() - lDone);
+#else
+        ssize_t lWritten = write(sFd, pText.data() + lDone, pText.size() - lDone);
+#endif
+        if (lWritten <= 0)
+            return;
+        lDone += lWritten;
+    }
+}
+
+void format(const LogRecord &pRecord, std::string &pOut)
+{
+    if (pRecord.mLevel == LOG_ERROR)
+        pOut += "error: ";
+    else if (pRecord.mLevel == LOG_WARNING)
+        pOut += "warning: ";
+
+    char lBuffer[64];
+    int lNext = 0;
+    for (const char *p = pRecord.mFormat; *p; ++p)
+    {
+        // {} or {.N}, anything else is copied as it is
+        int lDecimals = -1;
+        const char *lClose = nullptr;
+        if (*p == '{' && p[1] == '}')
+            lClose = p + 1;
+        else if (*p == '{' && p[1] == '.' && p[2] >= '0' && p[2] <= '9' && p[3] == '}')
+        {
+            lDecimals = p[2] - '0';
+            lClose = p + 3;
+        }
+        if (!lClose || lNext >= pRecord.mCount)
+        {
+            pOut += *p;
+            continue;
+        }
+
+        const LogRecord::Arg &lArg = pRecord.mArgs[lNext++];
+        switch (lArg.mKind)
+        {
+        case LogRecord::ARG_INT:
+            snprintf(lBuffer, sizeof(lBuffer), "%lld", (long long)lArg.mInt);
+            pOut += lBuffer;
+            break;
+        case LogRecord::ARG_UINT:
+            snprintf(lBuffer, sizeof(lBuffer), "%llu", (unsigned long long)lArg.mUInt);
+            pOut += lBuffer;
+            break;
+        case LogRecord::ARG_DOUBLE:
+            if (lDecimals >= 0)
+                snprintf(lBuffer, sizeof(lBuffer), "%.*f", lDecimals, lArg.mDouble);
+            else
+                snprintf(lBuffer, sizeof(lBuffer), "%g", lArg.mDouble);
+            pOut += lBuffer;
+            break;
+        case LogRecord::ARG_TEXT:
+            pOut.append(pRecord.mText + lArg.mText.mBegin, lArg.mText.mSize);
+            break;
+        case LogRecord::ARG_LONG_TEXT:
+            pOut.append(lArg.mLongText.mData, lArg.mLongText.mSize);
+            break;
+        case LogRecord::ARG_BOARD:
+        {
+            GameState lState;
+            memcpy((void*)&lState, pRecord.mBoard, sizeof(GameState));
+            pOut += lState.toString(lArg.mPlayer);
+            break;
+        }
+        }
+        p = lClose;
+    }
+    pOut += '\n';
+}
+
+///frees what \p pRecord has on the heap, once it is written
+void release(LogRecord &pRecord)
+{
+    for (int i = 0; i < pRecord.mCount; ++i)
+        if (pRecord.mArgs[i].mKind == LogRecord::ARG_LONG_TEXT)
+            delete[] pRecord.mArgs[i].mLongText.mData;
+}
+
+///writes out what the threads have logged, returns false if there was nothing
+bool drain()
+{
+    std::string lOut;
+    {
+        std::lock_guard<std::mutex> lLock(sMutex);
+        for (std::size_t r = 0; r < sRings.size(); ++r)
+        {
+            Ring &lRing = *sRings[r];
+            uint64_t lHead = lRing.mHead.load(std::memory_order_acquire);
+            uint64_t lTail = lRing.mTail.load(std::memory_order_relaxed);
+            for (; lTail < lHead; ++lTail)
+            {
+                LogRecord &lRecord = lRing.mRecords[lTail % Log::cCapacity];
+                format(lRecord, lOut);
+                release(lRecord);
+            }
+            lRing.mTail.store(lTail, std::memory_order_release);
+
+            uint64_t lDropped = lRing.mDropped.load(std::memory_order_relaxed);
+            if (lDropped != lRing.mReported)
+            {
+                char lBuffer[64];
+                snprintf(lBuffer, sizeof(lBuffer), "warning: %llu log messages dropped\n",
+                         (unsigned long long)(lDropped - lRing.mReported));
+                lOut += lBuffer;
+                lRing.mReported = lDropped;
+            }
+        }
+    }
+    writeAll(lOut);
+    return !lOut.empty();
+}
+
+void run()
+{
+    while (!sStop.load(std::memory_order_acquire))
+    {
+        if (drain())
+            continue;
+
+        // Look once more after saying that we sleep, for what came in the meantime
+        sSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (drain())
+        {
+            sSleeping = false;
+            continue;
+        }
+        std::unique_lock<std::mutex> lLock(sWakeMutex);
+        sWake.wait(lLock, []() { return !sSleeping.load() || sStop.load(); });
+        sSleeping = false;
+    }
+    drain();
+}
+
+/*namespace*/ }
+
+void LogRecord::add(std::string_view pText)
+{
+    Arg &lArg = next();
+    if (pText.size() > (std::size_t)(cText - mTextSize))
+    {
+        // Only cut if there is no memory for it either
+        lArg.mLongText.mData = new (std::nothrow) char[pText.size()];
+        if (lArg.mLongText.mData)
+        {
+            lArg.mKind = ARG_LONG_TEXT;
+            memcpy(lArg.mLongText.mData, pText.data(), pText.size());
+            lArg.mLongText.mSize = pText.size();
+            return;
+        }
+    }
+    lArg.mKind = ARG_TEXT;
+    std::size_t lSize = std::min(pText.size(), (std::size_t)(cText - mTextSize));
+    memcpy(mText + mTextSize, pText.data(), lSize);
+    lArg.mText.mBegin = mTextSize;
+    lArg.mText.mSize = (uint16_t)lSize;
+    mTextSize += lSize;
+}
+
+void LogRecord::add(const LogBoard &pBoard)
+{
+    Arg &lArg = next();
+    lArg.mKind = ARG_BOARD;
+    lArg.mPlayer = pBoard.mPlayer;
+    memcpy(mBoard, (const void*)&pBoard.mState, sizeof(GameState));
+}
+
+void Log::start(int pFd)
+{
+    if (sWriter.joinable())
+        return;
+    sFd = pFd;
+    sStop = false;
+    sWriter = std::thread(run);
+    sLevel = sWanted;
+
+    static bool sRegistered = false;
+    if (!sRegistered)
+    {
+        atexit(stop);
+        sRegistered = true;
+    }
+}
+
+void Log::stop()
+{
+    sLevel = -1;
+    if (!sWriter.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lLock(sWakeMutex);
+        sStop.store(true, std::memory_order_release);
+    }
+    sWake.notify_one();
+    sWriter.join();
+}
+
+void Log::setLevel(LogLevel pLevel)
+{
+    sWanted = pLevel;
+    if (sWriter.joinable())
+        sLevel = pLevel;
+}
+
+void Log::setRate(double pPerSecond)
+{
+    sRate = pPerSecond;
+}
+
+LogRecord *Log::claim()
+{
+    Ring &lRing = ring();
+
+    // Refill the allowance of the thread
+    std::chrono::steady_clock::time_point lNow = std::chrono::steady_clock::now();
+    lRing.mTokens = std::min((double)cCapacity, lRing.mTokens +
+                             sRate.load(std::memory_order_relaxed) * std::chrono::duration<double>(lNow - lRing.mRefill).count());
+    lRing.mRefill = lNow;
+
+    uint64_t lHead = lRing.mHead.load(std::memory_order_relaxed);
+    if (lRing.mTokens < 1 || lHead - lRing.mTail.load(std::memory_order_acquire) >= (uint64_t)cCapacity)
+    {
+        lRing.mDropped.fetch_add(1, std::memory_order_relaxed);
+        wake();
+        return nullptr;
+    }
+    lRing.mTokens -= 1;
+    return &lRing.mRecords[lHead % cCapacity];
+}
+
+void Log::commit()
+{
+    Ring &lRing = *tRing;
+    lRing.mHead.store(lRing.mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    wake();
+}
+
+/*namespace TICTACTOE3D*/ }
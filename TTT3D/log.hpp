@@ -0,0 +1,202 @@
+#ifndef _TICTACTOE3D_LOG_HPP_
+#define _TICTACTOE3D_LOG_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace TICTACTOE3D
+{
+
+enum LogLevel
+{
+    LOG_ERROR = 0,
+    LOG_WARNING = 1,
+    LOG_INFO = 2,
+    LOG_DEBUG = 3,
+    LOG_TRACE = 4
+};
+
+/*namespace TICTACTOE3D*/ }
+
+/**
+ * Messages above this level are removed at compile time, arguments and
+ * all. Build with e.g.
+ *
+ *     -DTTT_LOG_LEVEL=2
+ *
+ * to keep only errors, warnings and information (no verbose boards).
+ */
+#ifndef TTT_LOG_LEVEL
+#define TTT_LOG_LEVEL 3
+#endif
+
+/**
+ * Logs a message if \p pLevel is enabled
+ *
+ *     TTT_LOG(LOG_INFO, "play: depth {}  score {}  {.4} s", depth, score, seconds);
+ *
+ * Each {} takes the next argument; {.N} prints a floating point argument
+ * with N decimals. Integers, floating point numbers, strings and LogBoard
+ * can be given; the arguments are only evaluated when the level is enabled.
+ */
+#define TTT_LOG(pLevel, ...) \
+    do { \
+        if ((pLevel) <= TTT_LOG_LEVEL && ::TICTACTOE3D::Log::enabled(pLevel)) \
+            ::TICTACTOE3D::Log::write((pLevel), __VA_ARGS__); \
+    } while (0)
+
+namespace TICTACTOE3D
+{
+
+///a board to log, rendered with GameState::toString(mPlayer) by the writer
+struct LogBoard
+{
+    const GameState &mState;
+    int mPlayer;
+};
+
+/**
+ * One message waiting to be written: the format and copies of the arguments
+ */
+struct LogRecord
+{
+    static const int cMaxArgs = 8;
+    static const int cText = 256;
+
+    enum Kind : uint8_t
+    {
+        ARG_INT,
+        ARG_UINT,
+        ARG_DOUBLE,
+        ARG_TEXT,
+        ARG_LONG_TEXT,      ///< a string argument that did not fit in mText, on the heap
+        ARG_BOARD
+    };
+
+    struct Arg
+    {
+        Kind mKind;
+        union
+        {
+            int64_t mInt;
+            uint64_t mUInt;
+            double mDouble;
+            struct { uint16_t mBegin; uint16_t mSize; } mText;
+            struct { char *mData; std::size_t mSize; } mLongText;   ///< freed by the writer
+            int mPlayer;
+        };
+    };
+
+    const char *mFormat;
+    uint8_t mLevel;
+    uint8_t mCount;
+    uint16_t mTextSize;
+    Arg mArgs[cMaxArgs];
+    char mText[cText];              ///< the string arguments, as long as they fit
+    alignas(GameState) unsigned char mBoard[sizeof(GameState)];
+
+    template<class T>
+    typename std::enable_if<std::is_integral<T>::value>::type add(T pValue)
+    {
+        Arg &lArg = next();
+        if (std::is_signed<T>::value)
+        {
+            lArg.mKind = ARG_INT;
+            lArg.mInt = pValue;
+        }
+        else
+        {
+            lArg.mKind = ARG_UINT;
+            lArg.mUInt = pValue;
+        }
+    }
+
+    template<class T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type add(T pValue)
+    {
+        Arg &lArg = next();
+        lArg.mKind = ARG_DOUBLE;
+        lArg.mDouble = pValue;
+    }
+
+    void add(std::string_view pText);
+    void add(const char *pText)         {   add(std::string_view(pText));   }
+    void add(const std::string &pText)  {   add(std::string_view(pText));   }
+    void add(const LogBoard &pBoard);
+
+private:
+    Arg &next()
+    {
+        return mArgs[mCount++];
+    }
+};
+
+/**
+ * Diagnostics written by a background thread
+ *
+ * Every thread puts its messages in a ring buffer of its own, which only
+ * it writes to; nothing is locked and nothing is formatted on the calling
+ * thread. The writer thread formats the messages and writes them to the
+ * output; it sleeps while there is nothing to write and the next message
+ * wakes it, so a quiet log takes no time on the clock of the process. Strings longer than a record holds are copied to the heap rather
+ * than cut, so that e.g. a JSON summary always comes out whole. A thread that logs more than the rate allows, or faster than the
+ * writer keeps up with, loses messages, and the writer says how many.
+ *
+ * Nothing is logged until start() is called.
+ */
+class Log
+{
+public:
+    ///messages a thread can have waiting
+    static const int cCapacity = 256;
+
+    ///starts the writer thread on the file descriptor \p pFd; it is stopped on exit
+    static void start(int pFd = 2);
+
+    ///writes the waiting messages and stops the writer thread
+    static void stop();
+
+    ///sets the most detailed level logged
+    static void setLevel(LogLevel pLevel);
+
+    ///sets the messages per second each thread may log, beyond a burst of cCapacity
+    static void setRate(double pPerSecond);
+
+    static bool enabled(LogLevel pLevel)
+    {
+        return (int)pLevel <= sLevel.load(std::memory_order_relaxed);
+    }
+
+    template<class... A>
+    static void write(LogLevel pLevel, const char *pFormat, const A&... pArgs)
+    {
+        static_assert(sizeof...(A) <= LogRecord::cMaxArgs, "too many arguments for TTT_LOG");
+        LogRecord *lRecord = claim();
+        if (!lRecord)
+            return;
+        lRecord->mFormat = pFormat;
+        lRecord->mLevel = (uint8_t)pLevel;
+        lRecord->mCount = 0;
+        lRecord->mTextSize = 0;
+        (lRecord->add(pArgs), ...);
+        commit();
+    }
+
+private:
+    ///returns the next free record of the calling thread, or null if the message must be dropped
+    static LogRecord *claim();
+
+    ///hands the claimed record to the writer
+    static void commit();
+
+    ///-1 until start()
+    static std::atomic<int> sLevel;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -1,16 +1,56 @@
-#include "player.hpp"
+#include "engine.hpp"
+#include "frame.hpp"
+#include "gamerecord.hpp"
+#include "log.hpp"
+#include "messageio.hpp"
+#include "telemetry.hpp"
+#include "trace.hpp"
 
 #include <stdlib.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <string>
-#include <vector>
+#include <string_view>
 
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t nanoseconds(Clock::time_point pFrom, Clock::time_point pTo)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(pTo - pFrom).count();
+}
+
+///hands the telemetry of the game and of the whole process to the dump
+void publish(const TICTACTOE3D::MoveTelemetry &pGame, const TICTACTOE3D::MoveTelemetry &pProcess)
+{
+    std::string lJson = "{\"unit\":\"ns\",\"game\":";
+    pGame.toJson(lJson);
+    lJson += ",\"process\":";
+    pProcess.toJson(lJson);
+    lJson += "}\n";
+    TICTACTOE3D::TelemetryDump::publish(lJson);
+}
+
+/*namespace*/ }
+
+// TTT is the referee's side of the engine library: it reads the states sent by
+// the other player, lets the engine (engine.hpp) reply, and sends the replies
 int main(int argc, char **argv)
 {
+    TICTACTOE3D::Engine engine;
+
     // Parse parameters
     bool init = false;
     bool verbose = false;
     bool fast = false;
+    bool binary = false;
+    bool check = false;
+    std::string record;
+    std::string telemetry;
+    std::string trace;
     for (int i = 1; i < argc; ++i)
     {
         std::string param(argv[i]);
@@ -20,6 +60,24 @@ int main(int argc, char **argv)
             verbose = true;
         else if (param == "fast" || param == "f")
             fast = true;
+        else if (param == "binary" || param == "b")
+            binary = true;
+        else if (param == "check" || param == "c")
+            check = true;
+        else if (param.compare(0, 7, "record=") == 0)
+            record = param.substr(7);
+        else if (param.compare(0, 10, "telemetry=") == 0)
+            telemetry = param.substr(10);
+        else if (param.compare(0, 6, "trace=") == 0)
+            trace = param.substr(6);
+        else if (param.find('=') != std::string::npos)
+        {
+            if (!engine.configure(param))
+            {
+                std::cerr << "Invalid option: '" << argv[i] << "'" << std::endl;
+                return -1;
+            }
+        }
         else
         {
             std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
@@ -27,26 +85,79 @@ int main(int argc, char **argv)
         }
     }
 
+    // Diagnostics are written by a thread of their own, the boards only if "verbose" is given
+    TICTACTOE3D::Log::setLevel(verbose ? TICTACTOE3D::LOG_DEBUG : TICTACTOE3D::LOG_INFO);
+    TICTACTOE3D::Log::start();
+
+    // The messages are read and written without going through the iostreams. With the
+    // parameter "binary" they are the frames of frame.hpp instead of lines of text
+    TICTACTOE3D::MessageReader reader;
+    TICTACTOE3D::MessageWriter writer;
+    char buffer[TICTACTOE3D::GameState::cMaxMessage];
+    TICTACTOE3D::Frame frame;
+
     // Start the game by sending the starting board without moves if the parameter "init" is given
     if (init)
     {
         std::string message = TICTACTOE3D::GameState().toMessage();
-        std::cerr << "Sending initial board: '" << message << "'" << std::endl;
-        std::cout << message << std::endl;
+        TTT_LOG(TICTACTOE3D::LOG_INFO, "Sending initial board: '{}'", message);
+        if (binary)
+        {
+            frame.encode(TICTACTOE3D::GameState(), 0);
+            writer.sendBlock(frame.mBytes, TICTACTOE3D::Frame::cSize);
+        }
+        else
+            writer.send(message);
     }
 
-    TICTACTOE3D::Player player;
+    // Keep the game in a record file if the parameter "record=FILE" is given
+    TICTACTOE3D::GameRecordWriter recorder(true);
+    TICTACTOE3D::GameRecord game;
+    if (!record.empty() && !recorder.open(record))
+        return -1;
+
+    // Keep timings of every move if the parameter "telemetry=FILE" is given, they
+    // are written to FILE on exit, on SIGINT or SIGTERM, and on SIGUSR1
+    TICTACTOE3D::MoveTelemetry game_telemetry, process_telemetry;
+    if (!telemetry.empty() && !TICTACTOE3D::TelemetryDump::install(telemetry))
+    {
+        std::cerr << "Invalid telemetry file: '" << telemetry << "'" << std::endl;
+        return -1;
+    }
+
+    // Keep a timeline of the search if the parameter "trace=FILE" is given, it is
+    // written to FILE in the Chrome trace format when the game ends
+    if (!trace.empty())
+    {
+        TICTACTOE3D::Trace::enable();
+        TICTACTOE3D::Trace::nameThread("main");
+    }
 
-    std::string input_message;
-    while (std::getline(std::cin, input_message))
+    std::string_view input_message;
+    while (binary ? reader.next(input_message, TICTACTOE3D::Frame::cSize) : reader.next(input_message))
     {
 
         // Get game state from standard input
         //std::cerr << "Receiving: '" << input_message << "'" << std::endl;
-        TICTACTOE3D::GameState input_state(input_message);
+        Clock::time_point received = Clock::now();
+        TICTACTOE3D::GameState input_state;
+        double budget = 0;
+        if (binary)
+        {
+            std::copy(input_message.begin(), input_message.end(), (char*)frame.mBytes);
+            if (!frame.decode(input_state, budget))
+            {
+                std::cerr << "*** ERROR! ***" << std::endl;
+                std::cerr << "Invalid frame" << std::endl;
+                exit(-1);
+            }
+        }
+        else
+            input_state = TICTACTOE3D::GameState(input_message);
+        uint64_t parse_time = nanoseconds(received, Clock::now());
 
         // See if we would produce the same message
-        if (input_state.toMessage() != input_message)
+        if (!binary && std::string_view(buffer, input_state.format(buffer) - buffer) != input_message)
         {
             std::cerr << "*** ERROR! ***" << std::endl;
             std::cerr << "Interpreted: '" << input_message << "'" << std::endl;
@@ -56,57 +167,101 @@ int main(int argc, char **argv)
         }
 
         // Print the input state
-        if (verbose)
-        {
-            std::cerr << input_state.toMessage() << std::endl;
-            std::cerr << input_state.toString(input_state.getNextPlayer()) << std::endl;
-        }
+        TTT_LOG(TICTACTOE3D::LOG_DEBUG, "{}\n{}", std::string_view(buffer, input_state.format(buffer) - buffer),
+                TICTACTOE3D::LogBoard{ input_state, input_state.getNextPlayer() });
+
+        game.add(input_state);
 
         // Quit if this is end of game
         if (input_state.getMove().isEOG())
             break;
 
-        // Deadline is 3 seconds from when we receive the message
-        TICTACTOE3D::Deadline deadline = TICTACTOE3D::Deadline::now() + (fast ? 0.01 : 0.25);
+        // Deadline is 3 seconds from when we receive the message, on the clock of the engine
+        // unless the frame received gives the time
+        TICTACTOE3D::Deadline deadline = engine.now() + (budget > 0 ? budget : fast ? 0.01 : 0.25);
 
         // Figure out the next move
-        TICTACTOE3D::GameState output_state = player.play(input_state, deadline);
+        Clock::time_point start = Clock::now();
+        TICTACTOE3D::GameState output_state = engine.play(input_state, deadline);
+        Clock::time_point done = Clock::now();
+        double seconds = std::chrono::duration<double>(done - start).count();
+        double margin = deadline.getSeconds() - engine.now().getSeconds();
+
+        if (!telemetry.empty())
+        {
+            uint64_t play_time = nanoseconds(start, done);
+            uint64_t margin_time = margin > 0 ? (uint64_t)(margin * 1e9) : 0;
+            for (TICTACTOE3D::MoveTelemetry *t : { &game_telemetry, &process_telemetry })
+            {
+                t->mParse.record(parse_time);
+                t->mPlay.record(play_time);
+                t->mMargin.record(margin_time);
+                t->mOverruns += (margin < 0);
+            }
+        }
 
-		if (deadline < TICTACTOE3D::Deadline::now()) {
+		if (deadline < engine.now()) {
             std::cerr<<"\nCrossed the deadline!!!";
+            if (!telemetry.empty())
+                publish(game_telemetry, process_telemetry);
+            if (!trace.empty())
+                TICTACTOE3D::Trace::write(trace);
 			exit(152);
 
 		}
 
-        // Check if output state is correct
-        std::vector<TICTACTOE3D::GameState> output_states;
-        input_state.findPossibleMoves(output_states);
-        bool output_state_correct = false;
-        for (unsigned int i = 0; i < output_states.size(); ++i)
-                if (output_state.isEqual(output_states[i]))
-                {
-                        output_state_correct = true;
-                        break;
-                }
-        if (!output_state_correct) {
+        // Check if output state is correct, if the parameter "check" is given
+        if (check && !input_state.isLegalSuccessor(output_state)) {
                 std::cerr<<"\nSomething is not correct!!!";
                 exit(134);
         }
 
+        TICTACTOE3D::MoveInfo info;
+        info.mScore = (float)engine.getLastScore();
+        info.mDepth = (uint16_t)engine.getLastDepth();
+        info.mTime = (uint16_t)std::min(seconds * 1e4, 65535.0);
+        game.add(output_state, info);
+
         // Print the output state
-        if (verbose)
+        TTT_LOG(TICTACTOE3D::LOG_DEBUG, "{}\n{}", std::string_view(buffer, output_state.format(buffer) - buffer),
+                TICTACTOE3D::LogBoard{ output_state, input_state.getNextPlayer() });
+
+        // Send the next move
+        Clock::time_point output_start = Clock::now();
+        if (binary)
+        {
+            // The time given to us is given on to the other player
+            frame.encode(output_state, budget);
+            writer.sendBlock(frame.mBytes, TICTACTOE3D::Frame::cSize);
+        }
+        else
         {
-            std::cerr << output_state.toMessage() << std::endl;
-            std::cerr << output_state.toString(input_state.getNextPlayer())    << std::endl;
+            std::string_view output_message(buffer, output_state.format(buffer) - buffer);
+            //std::cerr << "Sending: '" << output_message << "'"<< std::endl;
+            writer.send(output_message);
         }
 
-        // Send the next move
-        std::string output_message = output_state.toMessage();
-        //std::cerr << "Sending: '" << output_message << "'"<< std::endl;
-        std::cout << output_message << std::endl;
+        // The histograms are only turned into JSON once the move is out
+        if (!telemetry.empty())
+        {
+            uint64_t output_time = nanoseconds(output_start, Clock::now());
+            game_telemetry.mOutput.record(output_time);
+            process_telemetry.mOutput.record(output_time);
+            publish(game_telemetry, process_telemetry);
+        }
 
         // Quit if this is end of game
         if (output_state.getMove().isEOG())
             break;
     }
+
+    if (!trace.empty() && !TICTACTOE3D::Trace::write(trace))
+        std::cerr << "Cannot write '" << trace << "'" << std::endl;
+
+    if (!record.empty())
+    {
+        recorder.write(game);
+        if (!recorder.close())
+            return -1;
+    }
 }
@@ -0,0 +1,152 @@
+#include "messageio.hpp"
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace TICTACTOE3D
+{
+
+bool MessageReader::next(std::string_view &pLine)
+{
+    int lScan = mBegin;
+    for (;;)
+    {
+        const char *lNewline = (const char*)memchr(mBuffer + lScan, '\n', mEnd - lScan);
+        if (lNewline)
+        {
+            int lEnd = lNewline - mBuffer;
+            int lBegin = mBegin;
+            mBegin = lScan = lEnd + 1;
+            if (mSkip)
+            {
+                mSkip = false;
+                continue;
+            }
+            pLine = std::string_view(mBuffer + lBegin, lEnd - lBegin);
+            return true;
+        }
+
+        // Make room for the rest of the line
+        if (mSkip)
+            mBegin = mEnd = 0;
+        else if (mBegin > 0)
+        {
+            memmove(mBuffer, mBuffer + mBegin, mEnd - mBegin);
+            mEnd -= mBegin;
+            mBegin = 0;
+        }
+        else if (mEnd == cCapacity)
+        {
+            pLine = std::string_view(mBuffer, cCapacity);
+            mBegin = mEnd = 0;
+            mSkip = true;
+            return true;
+        }
+        lScan = mEnd;
+
+        int lRead = fill();
+        if (lRead < 0 && errno == EINTR)
+            continue;
+        if (lRead <= 0)
+        {
+            // A last line without an end of line still counts, as with std::getline
+            if (mSkip || mEnd == mBegin)
+                return false;
+            pLine = std::string_view(mBuffer + mBegin, mEnd - mBegin);
+            mBegin = mEnd;
+            return true;
+        }
+        mEnd += lRead;
+    }
+}
+
+bool MessageReader::next(std::string_view &pBlock, int pSize)
+{
+    if (pSize > cCapacity)
+        return false;
+    while (mEnd - mBegin < pSize)
+    {
+        if (mBegin > 0)
+        {
+            memmove(mBuffer, mBuffer + mBegin, mEnd - mBegin);
+            mEnd -= mBegin;
+            mBegin = 0;
+        }
+        int lRead = fill();
+        if (lRead < 0 && errno == EINTR)
+            continue;
+        if (lRead <= 0)
+            return false;
+        mEnd += lRead;
+    }
+    pBlock = std::string_view(mBuffer + mBegin, pSize);
+    mBegin += pSize;
+    return true;
+}
+
+int MessageReader::fill()
+{
+#ifdef _WIN32
+    return _read(mFd, mBuffer + mEnd, cCapacity - mEnd);
+#else
+    return read(mFd, mBuffer + mEnd, cCapacity - mEnd);
+#endif
+}
+
+bool MessageWriter::send(std::string_view pMessage)
+{
+#ifdef _WIN32
+    return _write(mFd, pMessage.data(), pMessage.size()) == (int)pMessage.size() && _write(mFd, "\n", 1) == 1;
+#else
+    struct iovec lParts[2] = { { (void*)pMessage.data(), pMessage.size() }, { (void*)"\n", 1 } };
+    std::size_t lLeft = pMessage.size() + 1;
+    int lPart = 0;
+    while (lLeft > 0)
+    {
+        ssize_t lWritten = writev(mFd, lParts + lPart, 2 - lPart);
+        if (lWritten < 0 && errno == EINTR)
+            continue;
+        if (lWritten <= 0)
+            return false;
+        lLeft -= lWritten;
+
+        // Skip what was written
+        while (lPart < 2 && (std::size_t)lWritten >= lParts[lPart].iov_len)
+            lWritten -= lParts[lPart++].iov_len;
+        if (lPart < 2)
+        {
+            lParts[lPart].iov_base = (char*)lParts[lPart].iov_base + lWritten;
+            lParts[lPart].iov_len -= lWritten;
+        }
+    }
+    return true;
+#endif
+}
+
+bool MessageWriter::sendBlock(const void *pData, std::size_t pSize)
+{
+    const char *lData = (const char*)pData;
+    while (pSize > 0)
+    {
+#ifdef _WIN32
+        int lWritten = _write(mFd, lData, pSize);
+#else
+        ssize_t lWritten = write(mFd, lData, pSize);
+#endif
+        if (lWritten < 0 && errno == EINTR)
+            continue;
+        if (lWritten <= 0)
+            return false;
+        lData += lWritten;
+        pSize -= lWritten;
+    }
+    return true;
+}
+
+/*namespace TICTACTOE3D*/ }
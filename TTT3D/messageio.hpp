@@ -0,0 +1,75 @@
+#ifndef _TICTACTOE3D_MESSAGEIO_HPP_
+#define _TICTACTOE3D_MESSAGEIO_HPP_
+
+#include <string_view>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Reads the messages of the protocol from a file descriptor, either one per
+ * line or as blocks of a fixed size
+ *
+ * Messages are handed out as views into a fixed buffer, valid until the next
+ * call to next(). Nothing is allocated after construction, and the reads
+ * go straight to the descriptor, past the buffering of std::cin.
+ */
+class MessageReader
+{
+public:
+    static const int cCapacity = 4096;
+
+    explicit MessageReader(int pFd = 0)
+        :   mFd(pFd),
+            mBegin(0),
+            mEnd(0),
+            mSkip(false)
+    {
+    }
+
+    ///gets the next line without its end of line, returns false at the end of the input
+    ///
+    ///A line longer than cCapacity is cut to its first cCapacity characters.
+    bool next(std::string_view &pLine);
+
+    ///gets the next \p pSize bytes (at most cCapacity), returns false if the input ends first
+    bool next(std::string_view &pBlock, int pSize);
+
+private:
+    ///reads what is available after mEnd, returns the result of read()
+    int fill();
+
+    int mFd;
+    int mBegin;     ///< start of the unread data in mBuffer
+    int mEnd;       ///< end of the data in mBuffer
+    bool mSkip;     ///< dropping the rest of a line that was too long
+    char mBuffer[cCapacity];
+};
+
+/**
+ * Writes messages to a file descriptor, each followed by an end of line
+ *
+ * Every message goes out with its end of line in a single write, so the
+ * other player sees it whole as soon as send() returns.
+ */
+class MessageWriter
+{
+public:
+    explicit MessageWriter(int pFd = 1)
+        :   mFd(pFd)
+    {
+    }
+
+    ///sends \p pMessage and an end of line, returns false if they could not be written
+    bool send(std::string_view pMessage);
+
+    ///sends \p pSize bytes as they are
+    bool sendBlock(const void *pData, std::size_t pSize);
+
+private:
+    int mFd;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
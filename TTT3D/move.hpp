@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <cassert>
 #include <iostream>
@@ -34,12 +35,16 @@ public:
         MOVE_NULL=-5   ///< a null move
     };
 
+    ///most squares a move can hold
+    static const int cMaxLength = 12;
+
 public:
     ///constructs a special type move
     
     ///\param pType should be one of MOVE_BOG, MOVE_XW, MOVE_OW or MOVE_DRAW
     explicit Move(MoveType pType=MOVE_BOG)
-        :   mType(pType)
+        :   mType(pType),
+            mLength(0)
     {
     }
 
@@ -47,9 +52,9 @@ public:
     ///\param p1 the destination square
 	///\param p2 is the player symbol
     Move(uint8_t p1,Cell p2)
-        :	mType(MOVE_NORMAL)
+        :	mType(MOVE_NORMAL),
+            mLength(2)
     {
-    	mData.resize(2);
     	mData[0] = p1;
 		mData[1] = p2;
     }
@@ -58,8 +63,8 @@ public:
     ///\param p1 the destination square
 	///\param p2 is the player symbol
     Move(uint8_t p1,Cell p2,int SpecialMove)        
+        :   mLength(2)
     {
-    	mData.resize(2);
     	mData[0] = p1;
 		mData[1] = p2;
 		if(SpecialMove==2)
@@ -81,10 +86,18 @@ public:
     
     ///\param pString a string, which should have been previously generated
     ///by ToString(), or obtained from the server
-    Move(const std::string &pString)
+    ///
+    ///Reads the same as a std::istringstream would, without allocating.
+    Move(std::string_view pString)
+        :   mLength(0)
     {
-        std::istringstream lStream(pString);        
-        lStream >> mType;
+        const char *lPos = pString.data();
+        const char *lEnd = lPos + pString.size();
+        if (!readInt(lPos, lEnd, mType))
+        {
+            mType=MOVE_NULL;
+            return;
+        }
         
         int lLen=0;
         
@@ -102,24 +115,27 @@ public:
 		if (mType==MOVE_DRAW)
             lLen=2;
             
-        if (lLen>12 || mType<MOVE_NULL)
+        if (lLen>cMaxLength || mType<MOVE_NULL)
         {
             mType=MOVE_NULL;
             return;
         }
             
-        mData.resize(lLen);
+        mLength=lLen;
             
         for (int i=0; i<lLen; ++i)
         {
             int lCell;
-            lStream.ignore(1, cDelimiter);
-            lStream >> lCell;            
+            // skip the delimiter
+            if (lPos != lEnd)
+                ++lPos;
+            if (!readInt(lPos, lEnd, lCell))
+            {
+                mType=MOVE_NULL;
+                return;
+            }
             mData[i]=lCell;
         }
-
-        if(!lStream)
-            mType=MOVE_NULL;
     }
 
    
@@ -143,21 +159,30 @@ public:
     int getType() const { return mType; }
     
     ///returns (for normal moves) the number of squares
-    std::size_t length() const { return mData.size(); }
+    std::size_t length() const { return mLength; }
     ///returns the pNth square in the sequence
     uint8_t operator[](int pN) const { return mData[pN]; }
 
     ///converts the move to a string so that it can be sent to the other player
     std::string toMessage() const
     {
-        std::ostringstream lStream;
-        lStream << mType;
-        for(unsigned i=0;i<mData.size();++i)
+        char lBuffer[cMaxMessage];
+        return std::string(lBuffer, format(lBuffer));
+    }
+
+    ///longest message of a move
+    static const int cMaxMessage = 12 + cMaxLength * 4;
+
+    ///writes toMessage() to \p pBuffer, which holds at least cMaxMessage characters, and returns the end
+    char *format(char *pBuffer) const
+    {
+        pBuffer = writeInt(pBuffer, mType);
+        for(unsigned i=0;i<mLength;++i)
         {
-            lStream << cDelimiter << (int)mData[i];
+            *pBuffer++ = cDelimiter;
+            pBuffer = writeInt(pBuffer, mData[i]);
         }
-        
-        return lStream.str();
+        return pBuffer;
     }
 
     ///converts the move to a human readable string so that it can be printed
@@ -176,11 +201,11 @@ public:
 
         std::ostringstream lStream;
     	char delimiter = isNormal() ? '-' : 'x';
-    	assert(mData.size() > 0);
+    	assert(mLength > 0);
 
     	// Concatenate all the cell numbers
 		lStream << (int)mData[0];
-        for(unsigned i=1; i<mData.size(); ++i)
+        for(unsigned i=1; i<mLength; ++i)
 		{
             lStream << delimiter << (int)mData[i];
 		}
@@ -191,16 +216,54 @@ public:
     bool operator==(const Move &pRH) const
     {
         if (mType != pRH.mType) return false;
-        if (mData.size() != pRH.mData.size()) return false;
+        if (mLength != pRH.mLength) return false;
         
-        for (unsigned i=0; i<mData.size(); ++i)
+        for (unsigned i=0; i<mLength; ++i)
             if (mData[i] != pRH.mData[i]) return false;
         return true;
     }
     
 private:
+    ///reads an integer as operator>> would, moving \p pPos past it; returns false if there is none
+    static bool readInt(const char *&pPos, const char *pEnd, int &pValue)
+    {
+        while (pPos != pEnd && (*pPos == ' ' || (*pPos >= '\t' && *pPos <= '\r')))
+            ++pPos;
+        bool lNegative = false;
+        if (pPos != pEnd && (*pPos == '-' || *pPos == '+'))
+            lNegative = (*pPos++ == '-');
+        if (pPos == pEnd || *pPos < '0' || *pPos > '9')
+            return false;
+        int lValue = 0;
+        while (pPos != pEnd && *pPos >= '0' && *pPos <= '9')
+            lValue = lValue * 10 + (*pPos++ - '0');
+        pValue = lNegative ? -lValue : lValue;
+        return true;
+    }
+
+    static char *writeInt(char *pBuffer, int pValue)
+    {
+        unsigned lValue = pValue;
+        if (pValue < 0)
+        {
+            *pBuffer++ = '-';
+            lValue = 0u - lValue;
+        }
+        char lDigits[10];
+        int lCount = 0;
+        do
+        {
+            lDigits[lCount++] = char('0' + lValue % 10);
+            lValue /= 10;
+        } while (lValue);
+        while (lCount)
+            *pBuffer++ = lDigits[--lCount];
+        return pBuffer;
+    }
+
     int mType;
-    std::vector<uint8_t> mData;
+    uint8_t mLength;
+    uint8_t mData[cMaxLength];
     static const char cDelimiter = '_';
 };
 
@@ -0,0 +1,262 @@
+#include "ntuple.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define TTT_X86_GATHER 1
+#include <immintrin.h>
+#endif
+
+namespace TICTACTOE3D
+{
+
+namespace
+{
+
+const char cMagic[8] = { 'T', 'T', 'T', '3', 'N', 'T', 'U', 'P' };
+const uint32_t cVersion = 1;
+const std::size_t cHeaderSize = 64;
+
+struct Header
+{
+    char mMagic[8];
+    uint32_t mVersion;
+    uint32_t mTuples;
+    uint32_t mEntries;
+    char mPadding[cHeaderSize - 20];
+};
+
+// The gathers read the offsets in blocks of 8
+static_assert(Tuples::cCount % 8 == 0, "the tuples must fill whole gathers");
+
+///allocates room for the weights on a cache line boundary
+float *allocateWeights()
+{
+    std::size_t lSize = ((NTupleNet::cWeights * sizeof(float) + 63) / 64) * 64;
+#ifdef _WIN32
+    return static_cast<float *>(_aligned_malloc(lSize, 64));
+#else
+    return static_cast<float *>(aligned_alloc(64, lSize));
+#endif
+}
+
+void freeWeights(float *pWeights)
+{
+#ifdef _WIN32
+    _aligned_free(pWeights);
+#else
+    free(pWeights);
+#endif
+}
+
+///fills \p pOffsets with the position of the selected entry of every tuple in the weights
+void offsets(uint64_t pX, uint64_t pO, int32_t *pOffsets)
+{
+    for (int t = 0; t < Tuples::cCount; ++t)
+        pOffsets[t] = t * Tuples::cEntries + NTupleNet::index(pX, pO, t);
+}
+
+float sumScalar(const float *pWeights, const int32_t *pOffsets)
+{
+    float lSum = 0;
+    for (int t = 0; t < Tuples::cCount; ++t)
+        lSum += pWeights[pOffsets[t]];
+    return lSum;
+}
+
+#ifdef TTT_X86_GATHER
+
+__attribute__((target("avx2")))
+float sumAvx2(const float *pWeights, const int32_t *pOffsets)
+{
+    __m256 lSum = _mm256_setzero_ps();
+    for (int t = 0; t < Tuples::cCount; t += 8)
+    {
+        __m256i lOffsets = _mm256_loadu_si256((const __m256i *)(pOffsets + t));
+        lSum = _mm256_add_ps(lSum, _mm256_i32gather_ps(pWeights, lOffsets, 4));
+    }
+    __m128 lHalf = _mm_add_ps(_mm256_castps256_ps128(lSum), _mm256_extractf128_ps(lSum, 1));
+    lHalf = _mm_add_ps(lHalf, _mm_movehl_ps(lHalf, lHalf));
+    lHalf = _mm_add_ss(lHalf, _mm_shuffle_ps(lHalf, lHalf, 1));
+    return _mm_cvtss_f32(lHalf);
+}
+
+#endif
+
+typedef float (*SumFunction)(const float *, const int32_t *);
+
+SumFunction sumFunction()
+{
+    static const SumFunction lFunction = []()
+    {
+#ifdef TTT_X86_GATHER
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return (SumFunction)sumAvx2;
+#endif
+        return (SumFunction)sumScalar;
+    }();
+    return lFunction;
+}
+
+/*namespace*/ }
+
+NTupleNet::NTupleNet()
+    :   mWeights(allocateWeights()),
+        mMapping(0),
+        mMappingSize(0)
+{
+    for (int i = 0; i < cWeights; ++i)
+        mWeights[i] = 0;
+}
+
+NTupleNet::~NTupleNet()
+{
+    release();
+}
+
+void NTupleNet::release()
+{
+#ifndef _WIN32
+    if (mMapping)
+    {
+        munmap(mMapping, mMappingSize);
+        mMapping = 0;
+        mWeights = 0;
+        return;
+    }
+#endif
+    freeWeights(mWeights);
+    mWeights = 0;
+}
+
+bool NTupleNet::load(const std::string &pFile)
+{
+    std::size_t lExpected = cHeaderSize + cWeights * sizeof(float);
+#ifndef _WIN32
+    int lFd = open(pFile.c_str(), O_RDONLY);
+    if (lFd < 0)
+    {
+        std::cerr << "Cannot open n-tuple file '" << pFile << "'" << std::endl;
+        return false;
+    }
+    struct stat lStat;
+    void *lMapping = MAP_FAILED;
+    if (fstat(lFd, &lStat) == 0 && (std::size_t)lStat.st_size == lExpected)
+        lMapping = mmap(0, lExpected, PROT_READ, MAP_SHARED, lFd, 0);
+    close(lFd);
+    if (lMapping == MAP_FAILED)
+    {
+        std::cerr << "Cannot map n-tuple file '" << pFile << "'" << std::endl;
+        return false;
+    }
+
+    const Header *lHeader = static_cast<const Header *>(lMapping);
+    if (memcmp(lHeader->mMagic, cMagic, sizeof(cMagic)) != 0 || lHeader->mVersion != cVersion ||
+        lHeader->mTuples != (uint32_t)Tuples::cCount || lHeader->mEntries != (uint32_t)Tuples::cEntries)
+    {
+        std::cerr << "'" << pFile << "' is not an n-tuple file for this network" << std::endl;
+        munmap(lMapping, lExpected);
+        return false;
+    }
+
+    release();
+    mMapping = lMapping;
+    mMappingSize = lExpected;
+    mWeights = reinterpret_cast<float *>(static_cast<char *>(lMapping) + cHeaderSize);
+    return true;
+#else
+    FILE *lFile = fopen(pFile.c_str(), "rb");
+    if (!lFile)
+    {
+        std::cerr << "Cannot open n-tuple file '" << pFile << "'" << std::endl;
+        return false;
+    }
+    Header lHeader;
+    float *lWeights = allocateWeights();
+    bool lOk = fread(&lHeader, sizeof(lHeader), 1, lFile) == 1 &&
+               memcmp(lHeader.mMagic, cMagic, sizeof(cMagic)) == 0 && lHeader.mVersion == cVersion &&
+               lHeader.mTuples == (uint32_t)Tuples::cCount && lHeader.mEntries == (uint32_t)Tuples::cEntries &&
+               fread(lWeights, sizeof(float), cWeights, lFile) == (std::size_t)cWeights;
+    fclose(lFile);
+    if (!lOk)
+    {
+        std::cerr << "'" << pFile << "' is not an n-tuple file for this network" << std::endl;
+        freeWeights(lWeights);
+        return false;
+    }
+    release();
+    mWeights = lWeights;
+    return true;
+#endif
+}
+
+bool NTupleNet::save(const std::string &pFile) const
+{
+    FILE *lFile = fopen(pFile.c_str(), "wb");
+    if (!lFile)
+        return false;
+
+    Header lHeader;
+    memset(&lHeader, 0, sizeof(lHeader));
+    memcpy(lHeader.mMagic, cMagic, sizeof(cMagic));
+    lHeader.mVersion = cVersion;
+    lHeader.mTuples = Tuples::cCount;
+    lHeader.mEntries = Tuples::cEntries;
+
+    bool lOk = fwrite(&lHeader, sizeof(lHeader), 1, lFile) == 1 &&
+               fwrite(mWeights, sizeof(float), cWeights, lFile) == (std::size_t)cWeights;
+    return (fclose(lFile) == 0) && lOk;
+}
+
+float *NTupleNet::mutableWeights()
+{
+    if (mMapping)
+    {
+        float *lWeights = allocateWeights();
+        memcpy(lWeights, mWeights, cWeights * sizeof(float));
+        release();
+        mWeights = lWeights;
+    }
+    return mWeights;
+}
+
+int NTupleNet::index(uint64_t pX, uint64_t pO, int pTuple)
+{
+    int lIndex = 0;
+    for (int i = 3; i >= 0; --i)
+    {
+        int lCell = cTuples.mCells[pTuple][i];
+        lIndex = lIndex * 3 + (int)((pX >> lCell) & 1) + 2 * (int)((pO >> lCell) & 1);
+    }
+    return lIndex;
+}
+
+float NTupleNet::evaluate(uint64_t pX, uint64_t pO) const
+{
+    int32_t lOffsets[Tuples::cCount];
+    offsets(pX, pO, lOffsets);
+    return sumFunction()(mWeights, lOffsets);
+}
+
+void NTupleActivation::reset(const NTupleNet &pNet, const GameState &pState)
+{
+    uint64_t lX = pState.getPieces(CELL_X);
+    uint64_t lO = pState.getPieces(CELL_O);
+    mNet = &pNet;
+    mSum = 0;
+    for (int t = 0; t < Tuples::cCount; ++t)
+    {
+        mIndex[t] = NTupleNet::index(lX, lO, t);
+        mSum += pNet.weights()[t * Tuples::cEntries + mIndex[t]];
+    }
+}
+
+/*namespace TICTACTOE3D*/ }
@@ -0,0 +1,194 @@
+#ifndef _TICTACTOE3D_NTUPLE_HPP_
+#define _TICTACTOE3D_NTUPLE_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Cells looked at by the n-tuple network
+ *
+ * Every tuple has 4 cells: first the 76 winning lines (numbered as in
+ * Lines), then the 108 2x2 squares lying in a plane of the cube, which
+ * see the neighbourhood of the lines. The contents of a tuple is read as
+ * a base 3 number whose digit i is the Cell value of its i-th cell, cells
+ * being taken in increasing order, so each tuple has 81 entries.
+ */
+struct Tuples
+{
+    static const int cCount = 184;          ///< tuples in the network
+    static const int cEntries = 81;         ///< entries per tuple (3^4)
+    static const int cMaxPerCell = 19;      ///< most tuples through one cell
+
+    uint8_t mCells[cCount][4];                  ///< cells of each tuple, in increasing order
+    uint8_t mCellCount[Lines::cCells];          ///< tuples through each cell
+    uint8_t mCellTuple[Lines::cCells][cMaxPerCell];  ///< tuples through each cell
+    uint8_t mCellPower[Lines::cCells][cMaxPerCell];  ///< weight of the cell's digit in those tuples
+};
+
+///builds the tuple tables from the line tables and the 2x2 squares of every plane
+constexpr Tuples makeTuples()
+{
+    Tuples lTuples{};
+    int lTuple = 0;
+    for (int l = 0; l < Lines::cCount; ++l, ++lTuple)
+        for (int i = 0; i < 4; ++i)
+            lTuples.mCells[lTuple][i] = cLines.mCells[l][i];
+
+    // strides of the two axes spanning each family of planes, and of the axis across them
+    const int lAxes[3][3] = { {4, 1, 16}, {4, 16, 1}, {1, 16, 4} };
+    for (int a = 0; a < 3; ++a)
+        for (int lPlane = 0; lPlane < 4; ++lPlane)
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j, ++lTuple)
+                {
+                    int lBase = lPlane * lAxes[a][2] + i * lAxes[a][0] + j * lAxes[a][1];
+                    int lCells[4] = { lBase, lBase + lAxes[a][1], lBase + lAxes[a][0], lBase + lAxes[a][0] + lAxes[a][1] };
+                    for (int m = 1; m < 4; ++m)
+                        for (int n = m; n > 0 && lCells[n - 1] > lCells[n]; --n)
+                        {
+                            int lTmp = lCells[n];
+                            lCells[n] = lCells[n - 1];
+                            lCells[n - 1] = lTmp;
+                        }
+                    for (int m = 0; m < 4; ++m)
+                        lTuples.mCells[lTuple][m] = lCells[m];
+                }
+
+    for (int t = 0; t < Tuples::cCount; ++t)
+    {
+        int lPower = 1;
+        for (int i = 0; i < 4; ++i, lPower *= 3)
+        {
+            int lCell = lTuples.mCells[t][i];
+            lTuples.mCellTuple[lCell][lTuples.mCellCount[lCell]] = t;
+            lTuples.mCellPower[lCell][lTuples.mCellCount[lCell]] = lPower;
+            ++lTuples.mCellCount[lCell];
+        }
+    }
+    return lTuples;
+}
+
+///the tuple tables of the network
+inline constexpr Tuples cTuples = makeTuples();
+
+static_assert(cTuples.mCellCount[0] == 7 + 3, "a corner lies on 7 lines and 3 squares");
+static_assert(cTuples.mCellCount[21] == Tuples::cMaxPerCell, "an inner cell lies on 7 lines and 12 squares");
+
+/**
+ * An n-tuple network: one table of weights per tuple, the value of a
+ * position being the sum of the weights selected by the contents of the
+ * tuples. Values are seen from X.
+ *
+ * The weights live in one flat array of Tuples::cCount * Tuples::cEntries
+ * floats aligned on a cache line. A network read from a file maps the
+ * file in memory instead of copying it, so many players can share the
+ * same pages.
+ *
+ * File layout: a 64 byte header (magic "TTT3NTUP", then the uint32 version,
+ * tuple count and entries per tuple) followed by the weights, tuple by tuple.
+ */
+class NTupleNet
+{
+public:
+    static const int cWeights = Tuples::cCount * Tuples::cEntries;
+
+    ///creates a network with all weights set to 0
+    NTupleNet();
+    ~NTupleNet();
+
+    ///maps the weights of \p pFile, returns false (and keeps the old weights) on error
+    bool load(const std::string &pFile);
+
+    ///writes the weights to \p pFile
+    bool save(const std::string &pFile) const;
+
+    ///returns the weights, tuple after tuple
+    const float *weights() const    {    return mWeights;    }
+
+    ///returns the weights for modification (copies them out of a mapped file first)
+    float *mutableWeights();
+
+    ///returns the entry of tuple \p pTuple selected by the position with X on \p pX and O on \p pO
+    static int index(uint64_t pX, uint64_t pO, int pTuple);
+
+    ///returns the value of the position with X on \p pX and O on \p pO
+    float evaluate(uint64_t pX, uint64_t pO) const;
+
+    ///returns the value of \p pState
+    float evaluate(const GameState &pState) const
+    {
+        return evaluate(pState.getPieces(CELL_X), pState.getPieces(CELL_O));
+    }
+
+private:
+    NTupleNet(const NTupleNet &);
+    NTupleNet &operator=(const NTupleNet &);
+
+    void release();
+
+    float *mWeights;
+    void *mMapping;         ///< start of the mapped file, or 0 if the weights are on the heap
+    std::size_t mMappingSize;
+};
+
+/**
+ * The entries of a network selected by a position, updated move by move
+ *
+ * The search calls play() when it steps into a child and undo() when it
+ * comes back, which only touches the tuples through the played cell.
+ */
+class NTupleActivation
+{
+public:
+    NTupleActivation()
+        :   mNet(0),
+            mSum(0)
+    {
+    }
+
+    ///reads all the entries of \p pState in \p pNet
+    void reset(const NTupleNet &pNet, const GameState &pState);
+
+    ///adds a piece of \p pPlayer on \p pCell
+    void play(int pCell, uint8_t pPlayer)
+    {
+        update(pCell, pPlayer);
+    }
+
+    ///removes the piece of \p pPlayer from \p pCell
+    void undo(int pCell, uint8_t pPlayer)
+    {
+        update(pCell, -(int)pPlayer);
+    }
+
+    ///returns the value of the current position
+    float getValue() const  {    return (float)mSum;    }
+
+private:
+    void update(int pCell, int pDigit)
+    {
+        const float *lWeights = mNet->weights();
+        for (int i = 0; i < cTuples.mCellCount[pCell]; ++i)
+        {
+            int lTuple = cTuples.mCellTuple[pCell][i];
+            const float *lTable = lWeights + lTuple * Tuples::cEntries;
+            int lIndex = mIndex[lTuple];
+            int lNext = lIndex + pDigit * cTuples.mCellPower[pCell][i];
+            mSum += (double)lTable[lNext] - lTable[lIndex];
+            mIndex[lTuple] = lNext;
+        }
+    }
+
+    const NTupleNet *mNet;
+    uint8_t mIndex[Tuples::cCount];
+    double mSum;            ///< the entries summed as doubles, so the value does not drift with the moves played and undone
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
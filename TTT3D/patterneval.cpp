@@ -0,0 +1,166 @@
+#include "patterneval.hpp"
+#include <fstream>
+#include <sstream>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define TTT_X86_PEXT 1
+#include <immintrin.h>
+#endif
+
+namespace TICTACTOE3D
+{
+
+namespace
+{
+
+const char *cClassNames[PatternEvaluator::cClasses] = { "straight", "face", "space" };
+
+struct Tables
+{
+    uint16_t mBase3[16];                    ///< 4 bits read as base 3 digits
+    uint8_t mClass[Lines::cCount];          ///< class of each line
+};
+
+constexpr Tables makeTables()
+{
+    Tables lTables{};
+    for (int b = 0; b < 16; ++b)
+        lTables.mBase3[b] = (b & 1) + 3 * ((b >> 1) & 1) + 9 * ((b >> 2) & 1) + 27 * ((b >> 3) & 1);
+    for (int l = 0; l < Lines::cCount; ++l)
+        lTables.mClass[l] = PatternEvaluator::lineClass(l);
+    return lTables;
+}
+
+constexpr Tables cTables = makeTables();
+
+///gathers the 4 bits of line \p pLine from \p pBits, lowest cell first
+inline int lineBits(uint64_t pBits, int pLine)
+{
+    const uint8_t *lCells = cLines.mCells[pLine];
+    return (int)(((pBits >> lCells[0]) & 1) | (((pBits >> lCells[1]) & 1) << 1) |
+                 (((pBits >> lCells[2]) & 1) << 2) | (((pBits >> lCells[3]) & 1) << 3));
+}
+
+int evaluatePortable(const int (*pWeight)[PatternEvaluator::cPatterns], uint64_t pX, uint64_t pO)
+{
+    int lScore = 0;
+    for (int l = 0; l < Lines::cCount; ++l)
+        lScore += pWeight[cTables.mClass[l]][cTables.mBase3[lineBits(pX, l)] + 2 * cTables.mBase3[lineBits(pO, l)]];
+    return lScore;
+}
+
+#ifdef TTT_X86_PEXT
+
+__attribute__((target("bmi2")))
+int evaluatePext(const int (*pWeight)[PatternEvaluator::cPatterns], uint64_t pX, uint64_t pO)
+{
+    int lScore = 0;
+    for (int l = 0; l < Lines::cCount; ++l)
+    {
+        uint64_t lMask = cLines.mMask[l];
+        lScore += pWeight[cTables.mClass[l]][cTables.mBase3[_pext_u64(pX, lMask)] + 2 * cTables.mBase3[_pext_u64(pO, lMask)]];
+    }
+    return lScore;
+}
+
+#endif
+
+/*namespace*/ }
+
+PatternEvaluator::PatternEvaluator()
+    :   mFunction(evaluatePortable)
+{
+#ifdef TTT_X86_PEXT
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2"))
+        mFunction = evaluatePext;
+#endif
+
+    for (int p = 0; p < cPatterns; ++p)
+    {
+        int lCount[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; ++i)
+            ++lCount[patternCell(p, i)];
+        for (int c = 0; c < cClasses; ++c)
+            mWeight[c][p] = cHeuristic[lCount[CELL_X]][lCount[CELL_O]];
+    }
+}
+
+int PatternEvaluator::pattern(uint64_t pX, uint64_t pO, int pLine)
+{
+    return cTables.mBase3[lineBits(pX, pLine)] + 2 * cTables.mBase3[lineBits(pO, pLine)];
+}
+
+int PatternEvaluator::patternCell(int pPattern, int pIndex)
+{
+    for (int i = 0; i < pIndex; ++i)
+        pPattern /= 3;
+    return pPattern % 3;
+}
+
+bool PatternEvaluator::load(const std::string &pFile)
+{
+    std::ifstream lFile(pFile.c_str());
+    if (!lFile)
+    {
+        std::cerr << "Cannot open weights file '" << pFile << "'" << std::endl;
+        return false;
+    }
+
+    int lWeight[cClasses][cPatterns];
+    bool lRead[cClasses] = { false, false, false };
+    std::string lLine;
+    while (std::getline(lFile, lLine))
+    {
+        std::istringstream lStream(lLine);
+        std::string lName;
+        if (!(lStream >> lName) || lName[0] == '#')
+            continue;
+
+        int lClass = 0;
+        while (lClass < cClasses && lName != cClassNames[lClass])
+            ++lClass;
+        if (lClass == cClasses)
+        {
+            std::cerr << "Unknown line class '" << lName << "' in " << pFile << std::endl;
+            return false;
+        }
+        for (int p = 0; p < cPatterns; ++p)
+            lStream >> lWeight[lClass][p];
+        if (!lStream)
+        {
+            std::cerr << "Expected " << cPatterns << " weights for '" << lName << "' in " << pFile << std::endl;
+            return false;
+        }
+        lRead[lClass] = true;
+    }
+
+    for (int c = 0; c < cClasses; ++c)
+        if (!lRead[c])
+        {
+            std::cerr << "Missing weights for '" << cClassNames[c] << "' in " << pFile << std::endl;
+            return false;
+        }
+
+    memcpy(mWeight, lWeight, sizeof(mWeight));
+    return true;
+}
+
+bool PatternEvaluator::save(const std::string &pFile) const
+{
+    std::ofstream lFile(pFile.c_str());
+    if (!lFile)
+        return false;
+
+    lFile << "# pattern weights: 81 per line class, pattern = sum of cell(i) * 3^i\n";
+    for (int c = 0; c < cClasses; ++c)
+    {
+        lFile << cClassNames[c];
+        for (int p = 0; p < cPatterns; ++p)
+            lFile << ' ' << mWeight[c][p];
+        lFile << '\n';
+    }
+    return (bool)lFile;
+}
+
+/*namespace TICTACTOE3D*/ }
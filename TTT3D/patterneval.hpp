@@ -0,0 +1,92 @@
+#ifndef _TICTACTOE3D_PATTERNEVAL_HPP_
+#define _TICTACTOE3D_PATTERNEVAL_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+#include <string>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Evaluates a position from the exact pattern of pieces on every line
+ *
+ * Each of the 4 cells of a line is empty, X or O, so a line is in one of
+ * 3^4 = 81 patterns. The pattern number is the base 3 number whose digit i
+ * is the contents (Cell) of the i-th cell of the line, cells being taken
+ * in increasing order.
+ *
+ * Lines are split in three classes (rows/columns/pillars, diagonals lying
+ * in a plane and space diagonals) and each class has its own table of 81
+ * weights. The score of a position is the sum, over all lines, of the
+ * weight of the line's pattern in its class table, seen from X.
+ *
+ * The default weights reproduce cHeuristic, so they give the same score as
+ * GameState::getScore(). Other weights are read from a text file:
+ *
+ *     # comments start with '#'
+ *     straight w0 w1 ... w80
+ *     face     w0 w1 ... w80
+ *     space    w0 w1 ... w80
+ *
+ * Patterns are extracted with the BMI2 pext instruction when the CPU has
+ * it, and by picking the 4 bits of the line one at a time otherwise.
+ */
+class PatternEvaluator
+{
+public:
+    enum LineClass
+    {
+        CLASS_STRAIGHT=0,       ///< rows, columns and pillars
+        CLASS_FACE=1,           ///< diagonals lying in a plane of the cube
+        CLASS_SPACE=2           ///< the 4 diagonals crossing the cube
+    };
+
+    static const int cClasses = 3;
+    static const int cPatterns = 81;
+
+    ///initializes the weights to match cHeuristic
+    PatternEvaluator();
+
+    ///returns the class of line \p pLine
+    static constexpr LineClass lineClass(int pLine)
+    {
+        return pLine < 48 ? CLASS_STRAIGHT : (pLine < 72 ? CLASS_FACE : CLASS_SPACE);
+    }
+
+    ///returns the pattern number of line \p pLine with X on \p pX and O on \p pO
+    static int pattern(uint64_t pX, uint64_t pO, int pLine);
+
+    ///returns the contents (a Cell value) of the \p pIndex-th cell of a line in pattern \p pPattern
+    static int patternCell(int pPattern, int pIndex);
+
+    ///reads the weights from \p pFile, returns false (and keeps the old weights) on error
+    bool load(const std::string &pFile);
+
+    ///writes the weights to \p pFile in the format read by load()
+    bool save(const std::string &pFile) const;
+
+    ///weight of pattern \p pPattern on a line of class \p pClass
+    int &weight(int pClass, int pPattern)               {    return mWeight[pClass][pPattern];    }
+    int weight(int pClass, int pPattern) const          {    return mWeight[pClass][pPattern];    }
+
+    ///scores the position with X on \p pX and O on \p pO
+    int evaluate(uint64_t pX, uint64_t pO) const
+    {
+        return mFunction(mWeight, pX, pO);
+    }
+
+    ///scores \p pState
+    int evaluate(const GameState &pState) const
+    {
+        return mFunction(mWeight, pState.getPieces(CELL_X), pState.getPieces(CELL_O));
+    }
+
+private:
+    int mWeight[cClasses][cPatterns];
+    int (*mFunction)(const int (*)[cPatterns], uint64_t, uint64_t);
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -0,0 +1,127 @@
+#include "perft.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+namespace
+{
+
+///the part of GameState that move generation needs
+struct Board
+{
+    uint64_t mPieces[2];
+    LineSet mOpen[2];
+};
+
+Board toBoard(const GameState &pState)
+{
+    Board lBoard;
+    lBoard.mPieces[0] = pState.getPieces(CELL_X);
+    lBoard.mPieces[1] = pState.getPieces(CELL_O);
+    lBoard.mOpen[0] = lBoard.mOpen[1] = LineSet();
+    for (int l = 0; l < Lines::cCount; ++l)
+    {
+        if (!(lBoard.mPieces[1] & cLines.mMask[l]))
+            lBoard.mOpen[0].add(l);
+        if (!(lBoard.mPieces[0] & cLines.mMask[l]))
+            lBoard.mOpen[1].add(l);
+    }
+    return lBoard;
+}
+
+///plays \p pCell for player \p pWho (0 for X), returns false if that ends the game
+bool play(Board &pBoard, int pWho, int pCell)
+{
+    uint64_t lOwn = (pBoard.mPieces[pWho] |= uint64_t(1) << pCell);
+    for (int i = 0; i < cLines.mCellCount[pCell]; ++i)
+    {
+        uint64_t lMask = cLines.mMask[cLines.mCellLines[pCell][i]];
+        if ((lOwn & lMask) == lMask)
+            return false;
+    }
+    pBoard.mOpen[pWho ^ 1].remove(cLines.mCellSet[pCell]);
+    return !(pBoard.mOpen[0].empty() && pBoard.mOpen[1].empty());
+}
+
+uint64_t countFast(const Board &pBoard, int pWho, int pDepth)
+{
+    uint64_t lEmpty = ~(pBoard.mPieces[0] | pBoard.mPieces[1]);
+    // Every empty cell is a move, whether it ends the game or not
+    if (pDepth == 1)
+        return popCount(lEmpty);
+
+    uint64_t lNodes = 0;
+    for (; lEmpty; lEmpty &= lEmpty - 1)
+    {
+        Board lChild = pBoard;
+        if (play(lChild, pWho, lowestBit(lEmpty)))
+            lNodes += countFast(lChild, pWho ^ 1, pDepth - 1);
+    }
+    return lNodes;
+}
+
+uint64_t countLegacy(const GameState &pState, int pDepth)
+{
+    std::vector<GameState> lChildren;
+    pState.findPossibleMoves(lChildren);
+    if (pDepth == 1)
+        return lChildren.size();
+
+    uint64_t lNodes = 0;
+    for (std::size_t i = 0; i < lChildren.size(); ++i)
+        lNodes += countLegacy(lChildren[i], pDepth - 1);
+    return lNodes;
+}
+
+/*namespace*/ }
+
+uint64_t perft(const GameState &pState, int pDepth, PerftMode pMode, int pThreads)
+{
+    if (pDepth <= 0)
+        return 1;
+    if (pState.isEOG())
+        return 0;
+
+    std::vector<GameState> lChildren;
+    pState.findPossibleMoves(lChildren);
+    if (pDepth == 1)
+        return lChildren.size();
+
+    // Split the moves at the root between the threads
+    Board lBoard = toBoard(pState);
+    int lWho = pState.getNextPlayer() - 1;
+    std::atomic<std::size_t> lNext(0);
+    std::atomic<uint64_t> lNodes(0);
+    auto lWork = [&]()
+    {
+        uint64_t lSum = 0;
+        for (std::size_t i; (i = lNext++) < lChildren.size(); )
+        {
+            const GameState &lChild = lChildren[i];
+            if (lChild.isEOG())
+                continue;
+            if (pMode == PERFT_LEGACY)
+                lSum += countLegacy(lChild, pDepth - 1);
+            else
+            {
+                Board lNextBoard = lBoard;
+                play(lNextBoard, lWho, lChild.getMove()[0]);
+                lSum += countFast(lNextBoard, lWho ^ 1, pDepth - 1);
+            }
+        }
+        lNodes += lSum;
+    };
+
+    std::vector<std::thread> lWorkers;
+    for (int t = 1; t < pThreads; ++t)
+        lWorkers.push_back(std::thread(lWork));
+    lWork();
+    for (std::size_t t = 0; t < lWorkers.size(); ++t)
+        lWorkers[t].join();
+    return lNodes;
+}
+
+/*namespace TICTACTOE3D*/ }
@@ -0,0 +1,30 @@
+#ifndef _TICTACTOE3D_PERFT_HPP_
+#define _TICTACTOE3D_PERFT_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Counts the positions reached after exactly \p pDepth moves from a state
+ * (perft), to measure and check move generation on its own.
+ *
+ * Games that end before \p pDepth moves add nothing to the count. The
+ * legacy mode walks the tree with findPossibleMoves and a GameState per
+ * node; the fast mode makes and tests moves on the bitboards only and
+ * counts the empty cells at the last ply. Both must give the same counts.
+ */
+enum PerftMode
+{
+    PERFT_LEGACY,
+    PERFT_FAST
+};
+
+///counts the positions \p pDepth moves after \p pState, the moves at the root are shared by \p pThreads threads
+uint64_t perft(const GameState &pState, int pDepth, PerftMode pMode = PERFT_FAST, int pThreads = 1);
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -1,230 +1,562 @@
 #include "player.hpp"
+#include "lineeval.hpp"
+#include "log.hpp"
+#include "trace.hpp"
 #include <cstdlib>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
 #include <math.h>
 
+// Build with -DTTT_CHECK_SCORE=1 (and without -DNDEBUG) to check the running
+// line score against a full rescan at the start of every search
+#ifndef TTT_CHECK_SCORE
+#define TTT_CHECK_SCORE 0
+#endif
+
 namespace TICTACTOE3D
 {
 
 double infinity = 100000000;
 double update(int num_x, int num_o);
 
+// Value of a won game for the n-tuple evaluation, whose sums stay far below it
+const double cNTupleWin = 1000;
+
+// Share of the time left that the search may use
+const double cTimeShare = 0.8;
+
+// The clock is read every cClockInterval + 1 nodes
+const uint64_t cClockInterval = 15;
+
+Player::Player()
+    :   max_p(CELL_X),
+        min_p(CELL_O),
+        mDepth(1),
+        mReport(REPORT_TEXT),
+        mRootDepth(0),
+        mLastScore(0),
+        mLastDepth(0),
+        mNodes(0),
+        mNodeLimit(0),
+        mMultiPV(1),
+        mClearTable(false),
+        mDeterministic(false),
+        mAborted(false),
+        mUsePatterns(false),
+        mKey(0),
+        mTableSide(CELL_EMPTY),
+        mClock(TIME_PROCESS),
+        mRootIndex(0),
+        mRootAlpha(0),
+        mRootValue(0),
+        mRootBest(0),
+        mTop(0),
+        mSearching(false),
+        mFinished(true),
+        mTracing(false),
+        mPlayBegin(0),
+        mIterationBegin(0)
+{
+}
+
+bool Player::configure(const std::string &pOption)
+{
+    std::string::size_type lEqual = pOption.find('=');
+    if (lEqual == std::string::npos)
+        return false;
+    std::string lName = pOption.substr(0, lEqual);
+    std::string lValue = pOption.substr(lEqual + 1);
+
+    if (lName == "weights")
+    {
+        if (!mPatterns.load(lValue))
+            return false;
+        mUsePatterns = true;
+        return true;
+    }
+    if (lName == "depth")
+    {
+        mDepth = atoi(lValue.c_str());
+        return mDepth > 0;
+    }
+    if (lName == "stats")
+    {
+        if (lValue == "off")
+            mReport = REPORT_OFF;
+        else if (lValue == "text")
+            mReport = REPORT_TEXT;
+        else if (lValue == "json")
+            mReport = REPORT_JSON;
+        else
+            return false;
+        return true;
+    }
+    if (lName == "clear" || lName == "deterministic")
+    {
+        if (lValue != "on" && lValue != "off")
+            return false;
+        (lName == "clear" ? mClearTable : mDeterministic) = (lValue == "on");
+        return true;
+    }
+    if (lName == "multipv")
+    {
+        int lLines = atoi(lValue.c_str());
+        if (lLines < 1)
+            return false;
+        mMultiPV = lLines;
+        return true;
+    }
+    if (lName == "nodes")
+    {
+        long long lNodes = atoll(lValue.c_str());
+        if (lNodes < 0)
+            return false;
+        mNodeLimit = (uint64_t)lNodes;
+        return true;
+    }
+    if (lName == "hash")
+    {
+        // A table that does not fit in memory (or in a size_t) leaves the one there is
+        long long lMegabytes = atoll(lValue.c_str());
+        if (lMegabytes < 0 || (unsigned long long)lMegabytes > (SIZE_MAX >> 20))
+            return false;
+        try
+        {
+            mTable.resize((std::size_t)lMegabytes << 20);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+        return true;
+    }
+    if (lName == "clock")
+    {
+        if (lValue == "process")
+            mClock = TIME_PROCESS;
+        else if (lValue == "thread")
+            mClock = TIME_THREAD;
+        else if (lValue == "wall")
+            mClock = TIME_WALL;
+        else
+            return false;
+        return true;
+    }
+    if (lName == "ntuple")
+    {
+        std::shared_ptr<NTupleNet> lNet = std::make_shared<NTupleNet>();
+        if (!lNet->load(lValue))
+            return false;
+        mNTuple = lNet;
+        return true;
+    }
+    return false;
+}
+
 GameState Player::play(const GameState &pState,const Deadline &pDue)
 {
     //std::cerr << "Processing " << pState.toMessage() << std::endl;
-	// Utility value
-    double v;
-    int depth = 1;
-    double alpha = -infinity;
-    double beta  = +infinity;
+    if (begin(pState, pDue))
+        while (!advance(UINT64_MAX))
+            ;
+    return result();
+}
 
-    // Define best state
-    GameState bestState;
+bool Player::begin(const GameState &pState, const Deadline &pDue)
+{
+#if TTT_CHECK_SCORE
+    // The running score must agree with a full rescan of the lines
+    assert(LineEvaluator().evaluate(pState) == pState.getScore());
+#endif
 
     // Find available actions given the current player and his action
-    std::vector<GameState> lNextStates;
-    pState.findPossibleMoves(lNextStates);
-
-    std::cerr<<"\nNumber of possible states are: "<<lNextStates.size();
+    mRootStates.clear();
+    pState.findPossibleMoves(mRootStates);
 
     // Define max and min player
     max_p = pState.getNextPlayer();
     min_p = max_p ^ (CELL_X | CELL_O);
 
-    if (lNextStates.size() == 0)
-        return GameState(pState, Move());
+    mSearching = false;
+    mFinished = true;
+    mTop = 0;
+    mLines.clear();
+    if (mRootStates.size() == 0)
+    {
+        mBestState = GameState(pState, Move());
+        return false;
+    }
+
+    if (mNTuple)
+        mActivation.reset(*mNTuple, pState);
 
-    // Otherwise running alpha-beta for max player
-    double bestValue = -infinity;
-    for(unsigned int i = 0; i<lNextStates.size(); i++)
+    mTracing = Trace::enabled();
+    mPlayBegin = mTracing ? Trace::clock() : 0;
+
+    // Leave some of the time for sending the move. A deterministic search does not look
+    // at the clock, it ends on depth and nodes alone
+    mNodes = 0;
+    mAborted = false;
+    mStop = (pDue.isValid() && !mDeterministic) ? now() + (pDue - now()) * cTimeShare : Deadline();
+    mIterations.clear();
+    SEARCH_STAT(mStats.clear());
+
+    // The values in the table are seen from the side that searched them
+    if (mTable.enabled())
+    {
+        if (mTableSide != max_p || mClearTable)
+            mTable.clear();
+        mTableSide = max_p;
+        mTable.newSearch();
+        mKey = cZobrist.hash(pState);
+    }
+    mStart = std::chrono::steady_clock::now();
+
+    // Iterative deepening: every depth starts with the best move of the one before
+    mSearching = true;
+    mFinished = false;
+    mRootDepth = 0;
+    startIteration();
+    return true;
+}
+
+bool Player::advance(uint64_t pNodes)
+{
+    uint64_t lStop = mNodes + std::min(pNodes, UINT64_MAX - mNodes);
+    while (!mFinished)
     {
-        v = alphabeta(lNextStates[i], min_p, depth-1, alpha, beta);
-        if(v > bestValue)
+        // Carry on with the move of the root that was left off, if any
+        GameState &lChild = mRootStates[mRootIndex];
+        if (mTop == 0)
         {
-            bestValue = v;
-            bestState = lNextStates[i];
-            alpha = bestValue;
+            enter(lChild);
+            push(lChild, min_p, mRootDepth - 1, mRootAlpha, +infinity);
         }
+        double v;
+        if (!resume(0, lStop, v))
+            return false;
+        leave(lChild);
+        if (!mAborted)
+        {
+            if (v > mRootValue)
+            {
+                mRootValue = v;
+                mRootBest = mRootIndex;
+            }
+            addRootLine(lChild, v);
+            if (++mRootIndex < mRootStates.size())
+                continue;
+        }
+        finishIteration();
     }
-
-    return bestState;
+    return true;
 }
 
-// Minimax algorithm with alpha-beta pruning
-double Player::alphabeta(const GameState &pState, uint8_t player, int depth, double alpha, double beta)
+GameState Player::result()
 {
-    std::vector<GameState> childStates;
-    double v = 0;
+    if (mSearching)
+    {
+        mSearching = false;
+        report(std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count());
+        if (mTracing)
+            Trace::add("play", mPlayBegin, Trace::clock(), "moves", mRootStates.size());
+    }
+    return mBestState;
+}
 
-    // Finds all the possible children states
-    pState.findPossibleMoves(childStates);
+void Player::addRootLine(const GameState &pState, double pValue)
+{
+    // The moves that do not beat the K-th best were only searched for a bound
+    if ((int)mRootLines.size() >= mMultiPV && pValue <= mRootLines.back().mScore)
+        return;
+
+    Line lLine;
+    lLine.mCell = pState.getMove()[0];
+    lLine.mScore = pValue;
+    lLine.mPv.push_back(lLine.mCell);
+    lLine.mPv.insert(lLine.mPv.end(), &mPv[1][0], &mPv[1][0] + mPvLength[1]);
+
+    // After the lines that are as good, so that the first of equal moves stays first
+    std::vector<Line>::iterator lAt = mRootLines.begin();
+    while (lAt != mRootLines.end() && lAt->mScore >= pValue)
+        ++lAt;
+    mRootLines.insert(lAt, lLine);
+    if ((int)mRootLines.size() > mMultiPV)
+        mRootLines.pop_back();
+
+    // Only a move that beats the K-th best needs an exact score from now on
+    if ((int)mRootLines.size() == mMultiPV)
+        mRootAlpha = mRootLines.back().mScore;
+}
 
-	// If depth is 0 or node is a leaf-node
-	if (depth ==0 || childStates.size()==0)
-	{
-		v = evaluation(pState);
-		std::cerr<<"\n The evaluation we get: "<<v;
-	}
+void Player::startIteration()
+{
+    ++mRootDepth;
+    mRootIndex = 0;
+    mRootAlpha = -infinity;
+    mRootValue = -infinity;
+    mRootBest = 0;
+    mRootLines.clear();
+    reserveFrames(mRootDepth);
+    mIterationBegin = mTracing ? Trace::clock() : 0;
+    SEARCH_STAT(++mStats.mPlyNodes[0]);
+}
 
-	// If player is MAX (X-player). We want X to win.
-	else if (player == max_p)
-	{
+void Player::finishIteration()
+{
+    if (mTracing)
+        Trace::add(mAborted ? "aborted iteration" : "iteration", mIterationBegin, Trace::clock(), "depth", mRootDepth);
+
+    // An unfinished depth is only used if there is nothing better
+    mFinished = true;
+    if (mAborted && !mIterations.empty())
+        return;
+    mBestState = mRootStates[mRootBest];
+    mLastScore = mRootValue;
+    mLastDepth = mRootDepth;
+    mLines = mRootLines;
+    if (mAborted)
+        return;
+
+    Iteration lIteration = { mRootDepth, mNodes,
+                             std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count() };
+    mIterations.push_back(lIteration);
+    std::rotate(mRootStates.begin(), mRootStates.begin() + mRootBest, mRootStates.begin() + mRootBest + 1);
+    if (mRootDepth < mDepth)
+    {
+        mFinished = false;
+        startIteration();
+    }
+}
 
-        v = -infinity;
-        // For every child
-        for(unsigned int i = 0; i<childStates.size(); i++)
+void Player::report(double pSeconds) const
+{
+    if (mReport == REPORT_OFF)
+        return;
+
+    double lNps = mNodes / std::max(pSeconds, 1e-9);
+    std::string lStats;
+#if TTT_SEARCH_STATS
+    lStats = mStats.format(mReport == REPORT_JSON);
+#endif
+
+    // With multipv=K the moves that came next, and what the search expects after them
+    std::string lLines;
+    if (mMultiPV > 1)
+    {
+        char lBuffer[64];
+        for (std::size_t l = 0; l < mLines.size(); ++l)
         {
-            v = std::max(v, alphabeta(childStates[i], min_p, depth-1, alpha, beta));
-            alpha = std::max(alpha, v);
-            // Prune if branch is not useful
-            if (beta<=alpha)
-                break;
+            if (mReport == REPORT_JSON)
+                snprintf(lBuffer, sizeof(lBuffer), "%s{\"score\":%g,\"pv\":[", l ? "," : ",\"lines\":[", mLines[l].mScore);
+            else
+                snprintf(lBuffer, sizeof(lBuffer), "\n  %d. score %g  pv", (int)l + 1, mLines[l].mScore);
+            lLines += lBuffer;
+            for (std::size_t m = 0; m < mLines[l].mPv.size(); ++m)
+            {
+                snprintf(lBuffer, sizeof(lBuffer), mReport == REPORT_JSON ? "%s%d" : "%s %d",
+                         (m && mReport == REPORT_JSON) ? "," : "", mLines[l].mPv[m]);
+                lLines += lBuffer;
+            }
+            if (mReport == REPORT_JSON)
+                lLines += (l + 1 == mLines.size()) ? "]}]" : "]}";
         }
     }
 
-    // If player is MIN (Y-player). We want Y to lose.
+    if (mReport == REPORT_JSON)
+        TTT_LOG(LOG_INFO, "{\"depth\":{},\"score\":{},\"nodes\":{},\"seconds\":{.6},\"nps\":{.0}{}{}}",
+                mLastDepth, mLastScore, mNodes, pSeconds, lNps, lStats, lLines);
     else
+        TTT_LOG(LOG_INFO, "play: depth {}  score {}  nodes {}  {.4} s  {.0} nodes/s{}{}",
+                mLastDepth, mLastScore, mNodes, pSeconds, lNps, lStats, lLines);
+}
+
+// Minimax algorithm with alpha-beta pruning
+double Player::alphabeta(const GameState &pState, uint8_t player, int depth, double alpha, double beta)
+{
+    std::size_t lBase = mTop;
+    reserveFrames(lBase + std::max(depth, 0) + 1);
+    push(pState, player, depth, alpha, beta);
+    double v = 0;
+    resume(lBase, UINT64_MAX, v);
+    return v;
+}
+
+// The recursion of alphabeta, turned into a loop over mFrames. A node is only
+// opened once the budget allows one more, so the search can stop before any of them
+bool Player::resume(std::size_t pBase, uint64_t pStop, double &pValue)
+{
+    for (;;)
     {
-        v = +infinity;
-        // For every child
-        for(unsigned int i = 0; i<childStates.size(); i++)
+        if (mNodes >= pStop)
+            return false;
+        if (!open(mFrames[mTop - 1]))
+            continue;
+
+        // Hand the value down to the nodes below, until one has another child to search
+        double v = mFrames[--mTop].mValue;
+        while (mTop > pBase)
         {
-            v = std::min(v, alphabeta(childStates[i], max_p, depth-1, alpha, beta));
-            beta = std::min(beta, v);
-            // Prune if branch is not useful
-            if (beta<=alpha)
+            Frame &lParent = mFrames[mTop - 1];
+            if (!next(lParent, v))
                 break;
+            store(lParent);
+            v = lParent.mValue;
+            --mTop;
+        }
+        if (mTop == pBase)
+        {
+            pValue = v;
+            return true;
         }
     }
+}
 
-    return v;
+bool Player::open(Frame &pFrame)
+{
+    const GameState &pState = *pFrame.mState;
+    std::vector<GameState> &childStates = pFrame.mChildren;
+    int depth = pFrame.mDepth;
+    pFrame.mValue = 0;
+
+    // Look at the clock now and then, and give up once the time is over
+    if ((++mNodes & cClockInterval) == 0 && mStop.isValid() && now() > mStop)
+        mAborted = true;
+    if (mNodeLimit && mNodes > mNodeLimit)
+        mAborted = true;
+    if (mAborted)
+        return true;
+    pFrame.mPly = std::min(mRootDepth - depth, cMaxPv - 2);
+    mPvLength[pFrame.mPly] = 0;
+    SEARCH_STAT(++mStats.mPlyNodes[std::min(mRootDepth - depth, SearchStats::cMaxPly - 1)]);
+
+    // A dead position is a draw whatever is played, so don't expand it
+    if (pState.getMove().isDraw())
+    {
+        SEARCH_STAT(++mStats.mLeaves);
+        return true;
+    }
+
+    // A result of an earlier search of the position can settle it, or at least says
+    // which move to try first
+    pFrame.mBest = TranspositionTable::cNoMove;
+    if (mTable.enabled() && depth > 0)
+    {
+        SEARCH_STAT(++mStats.mTTProbes);
+        if (const TranspositionTable::Entry *lEntry = mTable.probe(mKey))
+        {
+            SEARCH_STAT(++mStats.mTTHits);
+            pFrame.mBest = lEntry->mBest;
+            if (lEntry->mDepth >= depth)
+            {
+                pFrame.mValue = lEntry->mValue;
+                if (lEntry->mBound == TranspositionTable::BOUND_EXACT)
+                    return true;
+                if (lEntry->mBound == TranspositionTable::BOUND_LOWER)
+                    pFrame.mAlpha = std::max(pFrame.mAlpha, lEntry->mValue);
+                else if (lEntry->mBound == TranspositionTable::BOUND_UPPER)
+                    pFrame.mBeta = std::min(pFrame.mBeta, lEntry->mValue);
+                if (pFrame.mAlpha >= pFrame.mBeta)
+                    return true;
+            }
+        }
+    }
+
+    // Finds all the possible children states
+    childStates.clear();
+    pState.findPossibleMoves(childStates);
+    if (pFrame.mBest != TranspositionTable::cNoMove)
+    {
+        for (unsigned int i = 1; i < childStates.size(); i++)
+            if (childStates[i].getMove()[0] == pFrame.mBest)
+            {
+                std::swap(childStates[0], childStates[i]);
+                break;
+            }
+    }
+
+    // If depth is 0 or node is a leaf-node
+    if (depth == 0 || childStates.size() == 0)
+    {
+        // The evaluation is seen from X
+        pFrame.mValue = evaluation(pState);
+        if (max_p == CELL_O)
+            pFrame.mValue = -pFrame.mValue;
+        SEARCH_STAT(++mStats.mLeaves);
+        store(pFrame);
+        return true;
+    }
+
+    // MAX (the player to move at the root) wants the highest value, MIN the lowest
+    pFrame.mValue = (pFrame.mPlayer == max_p) ? -infinity : +infinity;
+    pFrame.mIndex = 0;
+    descend(pFrame);
+    return false;
 }
 
-double Player::evaluation(const GameState &pState)
+bool Player::next(Frame &pFrame, double pValue)
 {
-    const int Possible_wins = 76;
-
-    static const int win_state[Possible_wins][4] = {
-    {0,1,2,3},
-    {4,5,6,7},
-    {8,9,10,11},
-    {12,13,14,15},
-    {0,4,8,12},
-    {1,5,9,13},
-    {2,6,10,14},
-    {3,7,11,15},
-    {0,5,10,15},
-    {3,6,9,12},
-
-    {16,17,18,19},
-    {20,21,22,23},
-    {24,25,26,27},
-    {28,29,30,31},
-    {16,20,24,28},
-    {17,21,25,29},
-    {18,22,26,30},
-    {19,23,27,31},
-    {16,21,26,31},
-    {19,22,25,28},
-
-    {32,33,34,35},
-    {36,37,38,39},
-    {40,41,42,43},
-    {44,45,46,47},
-    {32,36,40,44},
-    {33,37,41,45},
-    {34,38,42,46},
-    {35,39,43,47},
-    {32,37,42,47},
-    {35,38,41,44},
-
-    {48,49,50,51},
-    {52,53,54,55},
-    {56,57,58,59},
-    {60,61,62,63},
-    {48,52,56,60},
-    {49,53,57,61},
-    {50,54,58,62},
-    {51,55,59,63},
-    {48,53,58,63},
-    {51,54,57,60},
-
-    {0,16,32,48},
-    {1,17,33,49},
-    {2,18,34,50},
-    {3,19,35,51},
-    {4,20,36,52},
-    {5,21,37,53},
-    {6,22,38,54},
-    {7,23,39,55},
-    {8,24,40,56},
-    {9,25,41,57},
-    {10,26,42,58},
-    {11,27,43,59},
-    {12,28,44,60},
-    {13,29,45,61},
-    {14,30,46,62},
-    {15,31,47,63},
-
-    {0,20,40,60},
-    {1,21,41,61},
-    {2,22,42,62},
-    {3,23,43,63},
-
-    {12,24,36,48},
-    {13,25,37,49},
-    {14,26,38,50},
-    {15,27,39,51},
-
-    {0,17,34,51},
-    {3,18,33,48},
-    {4,21,38,55},
-    {7,22,37,52},
-    {8,25,42,59},
-    {11,26,41,56},
-    {12,29,46,63},
-    {15,30,45,60},
-
-    {0,21,42,63},
-    {3,22,41,60},
-    {12,25,38,51},
-    {15,26,37,48}};
-
-    const int heuristic[5][5] = {
-    {      1,   -10,  -100, -1000, -10000 },
-    {     10,     0,     0,     0, 0      },
-    {    100,     0,     0,     0, 0      },
-    {   1000,     0,     0,     0, 0      },
-    {  10000,     0,     0,     0, 0      } };
-
-
-    double score = 0;
-    int num_x = 0;
-    int num_o = 0;
-    uint8_t piece;   // Location on the board
+    leave(pFrame.mChildren[pFrame.mIndex]);
+    if (pFrame.mPlayer == max_p ? pValue > pFrame.mValue : pValue < pFrame.mValue)
+    {
+        pFrame.mValue = pValue;
+        pFrame.mBest = pFrame.mChildren[pFrame.mIndex].getMove()[0];
+        updatePv(pFrame.mPly, pFrame.mBest);
+    }
+    if (mAborted)
+        return true;
+    if (pFrame.mPlayer == max_p)
+        pFrame.mAlpha = std::max(pFrame.mAlpha, pFrame.mValue);
+    else
+        pFrame.mBeta = std::min(pFrame.mBeta, pFrame.mValue);
 
-    max_p = pState.getNextPlayer();
-    min_p = max_p ^ (CELL_X | CELL_O);
+    // Prune if branch is not useful
+    if (pFrame.mBeta <= pFrame.mAlpha)
+    {
+        SEARCH_STAT(++mStats.mCutoffs);
+        SEARCH_STAT(if (pFrame.mIndex == 0) ++mStats.mFirstCutoffs);
+        return true;
+    }
+    if (++pFrame.mIndex == pFrame.mChildren.size())
+        return true;
+    descend(pFrame);
+    return false;
+}
 
-    for(unsigned int i=0; i<Possible_wins; i++)
+void Player::store(const Frame &pFrame)
+{
+    if (mTable.enabled() && pFrame.mDepth > 0 && !mAborted)
     {
-        num_x = 0;
-        num_o = 0;
-        for(int j=0; j<4;j++)
-        {
+        double v = pFrame.mValue;
+        TranspositionTable::Bound lBound = (v <= pFrame.mAlphaIn) ? TranspositionTable::BOUND_UPPER :
+                                           (v >= pFrame.mBetaIn) ? TranspositionTable::BOUND_LOWER : TranspositionTable::BOUND_EXACT;
+        mTable.store(mKey, v, pFrame.mDepth, lBound, pFrame.mBest);
+        SEARCH_STAT(++mStats.mTTStores);
+    }
+}
 
-            piece = pState.at(win_state[i][j]);
-            if(piece == CELL_X)
-                num_x++;
-            else if(piece == CELL_O)
-                num_o++;
-        }
-        score = score + heuristic[num_x][num_o];
+double Player::evaluation(const GameState &pState)
+{
+    SEARCH_STAT(++mStats.mEvaluations);
 
+    if (mNTuple)
+    {
+        // The network only rates open positions, a finished game is decided
+        if (pState.isXWin())
+            return cNTupleWin;
+        if (pState.isOWin())
+            return -cNTupleWin;
+        // Kept in step with pState by enter() and leave() during the search
+        return mActivation.getValue();
     }
 
-    return score;
+    if (mUsePatterns)
+        return mPatterns.evaluate(pState);
 
+    // The state keeps the sum of the line values up to date as moves are made
+    return pState.getScore();
 }
 
 
@@ -5,6 +5,16 @@
 #include "deadline.hpp"
 #include "move.hpp"
 #include "gamestate.hpp"
+#include "patterneval.hpp"
+#include "ntuple.hpp"
+#include "searchstats.hpp"
+#include "ttable.hpp"
+#include "zobrist.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace TICTACTOE3D
@@ -13,6 +23,13 @@ namespace TICTACTOE3D
 class Player
 {
 public:
+    enum Clock
+    {
+        TIME_PROCESS,
+        TIME_THREAD,
+        TIME_WALL
+    };
+
     ///perform a move
     ///\param pState the current state of the board
     ///\param pDue time before which we must have returned
@@ -20,9 +37,262 @@ public:
     uint8_t max_p;
     uint8_t min_p;
 
+    Player();
+
+    ///applies an option given on the command line as "name=value"
+    ///  weights=FILE   evaluate with the pattern weights read from FILE
+    ///  ntuple=FILE    evaluate with the n-tuple network read from FILE
+    ///  depth=N        search up to N plies ahead (default 1)
+    ///  stats=MODE     summary of every play(), logged at LOG_INFO: text (default), json or off
+    ///  multipv=K      search the K best moves exactly, each with its line (default 1)
+    ///  nodes=N        give up a depth once the search has taken N nodes (default 0: no limit)
+    ///  hash=MB        keep search results in a transposition table of MB megabytes (default 0: none)
+    ///  clear=on|off   empty the table before every play() (default off: it carries over)
+    ///  deterministic=on|off  ignore the deadline given to play(), so that only depth=N and nodes=N
+    ///                 end the search and the same position always gives the same nodes, move
+    ///                 and score (default off). For benchmarks, not for timed games
+    ///  clock=CLOCK    time the search with the CPU time of the process (default), the CPU time of
+    ///                 the thread that calls play() (thread), or the elapsed time (wall); the
+    ///                 deadline given to play() must be on the same clock
+    ///\return false if the option is unknown or could not be applied
+    bool configure(const std::string &pOption);
+
     GameState play(const GameState &pState, const Deadline &pDue);
+
+    /**
+     * play() in steps, for callers that search several games in turn on the
+     * same threads (see scheduler.hpp)
+     *
+     *     if (lPlayer.begin(lState, lDue))
+     *         while (!lPlayer.advance(1000))
+     *             ;   // e.g. search another game for a while
+     *     GameState lNext = lPlayer.result();
+     *
+     * gives the same move, after the same nodes, as play(lState, lDue). The
+     * search keeps its nodes in the player rather than on the call stack, so it
+     * can stop anywhere in the tree. The steps may run on different threads,
+     * as long as they do not overlap; use clock=wall then.
+     */
+    ///starts a search, returns false if there is nothing to search (result() is then ready)
+    bool begin(const GameState &pState, const Deadline &pDue);
+
+    ///searches until \p pNodes more nodes are searched, or until the search is over;
+    ///returns true once it is over
+    bool advance(uint64_t pNodes);
+
+    ///the next state chosen by the search, once advance() returned true
+    GameState result();
+
+    ///a depth completed by the iterative deepening of play()
+    struct Iteration
+    {
+        int mDepth;
+        uint64_t mNodes;        ///< nodes searched since play() started
+        double mSeconds;        ///< time since play() started
+    };
+
+    ///the deepest depth play() searches to, as set by depth=N
+    int getDepth() const            {   return mDepth;      }
+    void setDepth(int pDepth)       {   mDepth = pDepth;    }
+
+    ///forgets the results kept in the table, e.g. between games
+    void clearTable()               {   mTable.clear();     }
+
+    ///the most nodes play() searches, as set by nodes=N (0: no limit)
+    uint64_t getNodeLimit() const           {   return mNodeLimit;      }
+    void setNodeLimit(uint64_t pNodes)      {   mNodeLimit = pNodes;    }
+
+    ///the time on the clock the search is timed with (see clock=), to set deadlines on
+    Deadline now() const
+    {
+        if (mClock == TIME_THREAD)
+            return Deadline::threadNow();
+        if (mClock == TIME_WALL)
+            return Deadline::wallNow();
+        return Deadline::now();
+    }
+
+    ///a move and its score, with the moves the search expects to follow it
+    struct Line
+    {
+        int mCell;
+        double mScore;              ///< for the side to move, as getLastScore()
+        std::vector<int> mPv;       ///< cells played from the position, starting with mCell
+    };
+
+    ///the best moves of the last play(), best first: the multipv=K best, with exact scores,
+    ///from the deepest depth searched. A line stops short where the table settled a position
+    const std::vector<Line> &getLines() const   {   return mLines;      }
+
+    int getMultiPV() const          {   return mMultiPV;    }
+    void setMultiPV(int pLines)     {   mMultiPV = std::max(pLines, 1);     }
+
+    ///value (for the side that moved) and depth of the search behind the last play()
+    double getLastScore() const     {   return mLastScore;  }
+    int getLastDepth() const        {   return mLastDepth;  }
+
+    ///nodes searched by the last play()
+    uint64_t getLastNodes() const   {   return mNodes;      }
+
+    ///the depths completed by the last play()
+    const std::vector<Iteration> &getIterations() const    {   return mIterations;     }
+
+    ///counters of the last play(), all 0 unless built with TTT_SEARCH_STATS (see searchstats.hpp)
+    const SearchStats &getStats() const     {   return mStats;      }
+
+    ///the value of \p pState searched to \p depth plies, with \p player to move
     double alphabeta(const GameState &pState, uint8_t player, int depth, double alpha, double beta);
     double evaluation(const GameState &state);
+
+private:
+    ///a node of the search being searched, what alphabeta() would keep in its locals
+    struct Frame
+    {
+        const GameState *mState;
+        std::vector<GameState> mChildren;   ///< kept from one search to the next
+        unsigned mIndex;        ///< the child being searched
+        uint8_t mPlayer;
+        int mDepth;
+        int mPly;
+        double mAlpha;
+        double mBeta;
+        double mAlphaIn;        ///< the window the node was given, for the bound in the table
+        double mBetaIn;
+        double mValue;
+        int mBest;
+    };
+
+    ///puts the node \p pState on top of mFrames, to be opened by resume()
+    void push(const GameState &pState, uint8_t pPlayer, int pDepth, double pAlpha, double pBeta)
+    {
+        Frame &lFrame = mFrames[mTop++];
+        lFrame.mState = &pState;
+        lFrame.mPlayer = pPlayer;
+        lFrame.mDepth = pDepth;
+        lFrame.mAlpha = lFrame.mAlphaIn = pAlpha;
+        lFrame.mBeta = lFrame.mBetaIn = pBeta;
+    }
+
+    ///makes room on mFrames for \p pFrames nodes; not while resume() runs
+    void reserveFrames(std::size_t pFrames)
+    {
+        if (mFrames.size() < pFrames)
+            mFrames.resize(pFrames);
+    }
+
+    ///searches the nodes above \p pBase on mFrames until \p pStop nodes are searched (returns
+    ///false) or the node just above \p pBase has its value \p pValue (returns true)
+    bool resume(std::size_t pBase, uint64_t pStop, double &pValue);
+
+    ///searches the top node up to its children; returns true if it has its value without them
+    bool open(Frame &pFrame);
+
+    ///the child of \p pFrame being searched has the value \p pValue; pushes the next child
+    ///and returns false, or returns true if \p pFrame has its value
+    bool next(Frame &pFrame, double pValue);
+
+    ///pushes the child \p pFrame is at
+    void descend(Frame &pFrame)
+    {
+        const GameState &lChild = pFrame.mChildren[pFrame.mIndex];
+        enter(lChild);
+        push(lChild, pFrame.mPlayer == max_p ? min_p : max_p, pFrame.mDepth - 1, pFrame.mAlpha, pFrame.mBeta);
+    }
+
+    ///keeps the value of \p pFrame in the table
+    void store(const Frame &pFrame);
+
+    ///steps the incremental evaluation into the position \p pChild
+    void enter(const GameState &pChild)
+    {
+        if (mNTuple)
+            mActivation.play(pChild.getMove()[0], pChild.getMove()[1]);
+        if (mTable.enabled())
+            mKey ^= cZobrist.key(pChild.getMove()[0], pChild.getMove()[1]);
+    }
+
+    ///steps the incremental evaluation back out of the position \p pChild
+    void leave(const GameState &pChild)
+    {
+        if (mNTuple)
+            mActivation.undo(pChild.getMove()[0], pChild.getMove()[1]);
+        if (mTable.enabled())
+            mKey ^= cZobrist.key(pChild.getMove()[0], pChild.getMove()[1]);
+    }
+
+    ///the line of the best move at \p pPly becomes \p pCell and the line below it
+    void updatePv(int pPly, int pCell)
+    {
+        int lLength = std::min(mPvLength[pPly + 1], cMaxPv - 1);
+        mPv[pPly][0] = (uint8_t)pCell;
+        memcpy(&mPv[pPly][1], &mPv[pPly + 1][0], lLength);
+        mPvLength[pPly] = lLength + 1;
+    }
+
+    ///sets up the search of the next depth of the iterative deepening
+    void startIteration();
+
+    ///the root move \p pState scored \p pValue, keeps it if it is among the multipv=K best
+    void addRootLine(const GameState &pState, double pValue);
+
+    ///the search of a depth has been through all the moves of the root, or was given up
+    void finishIteration();
+
+    enum Report
+    {
+        REPORT_OFF,
+        REPORT_TEXT,
+        REPORT_JSON
+    };
+
+    ///writes the summary of a play() that took \p pSeconds
+    void report(double pSeconds) const;
+
+    int mDepth;
+    Report mReport;
+    int mRootDepth;
+    SearchStats mStats;
+    double mLastScore;
+    int mLastDepth;
+    uint64_t mNodes;
+    uint64_t mNodeLimit;
+    int mMultiPV;
+    bool mClearTable;
+    bool mDeterministic;
+    std::vector<Line> mLines;
+    bool mAborted;
+    Deadline mStop;
+    std::vector<Iteration> mIterations;
+    PatternEvaluator mPatterns;
+    bool mUsePatterns;
+    std::shared_ptr<NTupleNet> mNTuple;
+    NTupleActivation mActivation;
+    TranspositionTable mTable;
+    uint64_t mKey;              ///< Zobrist key of the position searched, kept when mTable is enabled
+    uint8_t mTableSide;         ///< the side the values in mTable are seen from
+    Clock mClock;
+
+    // The search between begin() and result()
+    std::vector<GameState> mRootStates;
+    unsigned mRootIndex;        ///< next move of the root to search
+    double mRootAlpha;
+    double mRootValue;          ///< best value of the depth being searched
+    unsigned mRootBest;
+    std::vector<Line> mRootLines;   ///< best moves of the depth being searched
+    std::vector<Frame> mFrames;     ///< the nodes being searched, the root move at the bottom
+    std::size_t mTop;               ///< nodes on mFrames
+
+    // The best line below each ply of the search
+    static const int cMaxPv = GameState::cSquares + 2;
+    uint8_t mPv[cMaxPv][cMaxPv];
+    int mPvLength[cMaxPv];
+    GameState mBestState;
+    bool mSearching;
+    bool mFinished;
+    bool mTracing;
+    uint64_t mPlayBegin;        ///< on the clock of Trace
+    uint64_t mIterationBegin;
+    std::chrono::steady_clock::time_point mStart;
 };
 
 /*namespace TICTACTOE*/ }
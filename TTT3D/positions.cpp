@@ -0,0 +1,86 @@
+#include "positions.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace TICTACTOE3D
+{
+
+namespace
+{
+
+const char cMagic[8] = { 'T', 'T', 'T', '3', 'P', 'O', 'S', '1' };
+
+void putBits(unsigned char *pOut, uint64_t pBits)
+{
+    for (int i = 0; i < 8; ++i)
+        pOut[i] = (unsigned char)(pBits >> (8 * i));
+}
+
+uint64_t getBits(const unsigned char *pIn)
+{
+    uint64_t lBits = 0;
+    for (int i = 7; i >= 0; --i)
+        lBits = (lBits << 8) | pIn[i];
+    return lBits;
+}
+
+/*namespace*/ }
+
+bool PositionFile::read(const std::string &pFile, std::vector<LabelledPosition> &pPositions)
+{
+    FILE *lFile = fopen(pFile.c_str(), "rb");
+    if (!lFile)
+    {
+        std::cerr << "Cannot open position file '" << pFile << "'" << std::endl;
+        return false;
+    }
+
+    char lMagic[sizeof(cMagic)];
+    if (fread(lMagic, sizeof(lMagic), 1, lFile) != 1 || memcmp(lMagic, cMagic, sizeof(cMagic)) != 0)
+    {
+        std::cerr << "'" << pFile << "' is not a position file" << std::endl;
+        fclose(lFile);
+        return false;
+    }
+
+    // Read in large blocks, the corpus may hold millions of positions
+    std::vector<unsigned char> lBuffer(cRecordSize * 65536);
+    std::size_t lRead;
+    while ((lRead = fread(&lBuffer[0], cRecordSize, 65536, lFile)) > 0)
+    {
+        for (std::size_t i = 0; i < lRead; ++i)
+        {
+            const unsigned char *lRecord = &lBuffer[i * cRecordSize];
+            LabelledPosition lPosition;
+            lPosition.mX = getBits(lRecord);
+            lPosition.mO = getBits(lRecord + 8);
+            lPosition.mResult = (int8_t)lRecord[16];
+            pPositions.push_back(lPosition);
+        }
+    }
+
+    bool lOk = !ferror(lFile);
+    fclose(lFile);
+    return lOk;
+}
+
+bool PositionFile::write(const std::string &pFile, const std::vector<LabelledPosition> &pPositions)
+{
+    FILE *lFile = fopen(pFile.c_str(), "wb");
+    if (!lFile)
+        return false;
+
+    bool lOk = fwrite(cMagic, sizeof(cMagic), 1, lFile) == 1;
+    unsigned char lRecord[cRecordSize];
+    for (std::size_t i = 0; lOk && i < pPositions.size(); ++i)
+    {
+        putBits(lRecord, pPositions[i].mX);
+        putBits(lRecord + 8, pPositions[i].mO);
+        lRecord[16] = (unsigned char)pPositions[i].mResult;
+        lOk = fwrite(lRecord, cRecordSize, 1, lFile) == 1;
+    }
+    return (fclose(lFile) == 0) && lOk;
+}
+
+/*namespace TICTACTOE3D*/ }
@@ -0,0 +1,41 @@
+#ifndef _TICTACTOE3D_POSITIONS_HPP_
+#define _TICTACTOE3D_POSITIONS_HPP_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * A position together with the result of the game it was taken from
+ */
+struct LabelledPosition
+{
+    uint64_t mX;        ///< cells held by X
+    uint64_t mO;        ///< cells held by O
+    int8_t mResult;     ///< 1 if X won, -1 if O won, 0 for a draw
+};
+
+/**
+ * Files of labelled positions, used to tune the evaluation
+ *
+ * An 8 byte magic ("TTT3POS1") followed by 17 bytes per position: the X
+ * and O bitboards (little endian) and the result.
+ */
+class PositionFile
+{
+public:
+    static const std::size_t cRecordSize = 17;
+
+    ///appends the positions of \p pFile to \p pPositions, returns false on error
+    static bool read(const std::string &pFile, std::vector<LabelledPosition> &pPositions);
+
+    ///writes \p pPositions to \p pFile, returns false on error
+    static bool write(const std::string &pFile, const std::vector<LabelledPosition> &pPositions);
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef _TICTACTOE3D_SCHEDULER_HPP_
+#define _TICTACTOE3D_SCHEDULER_HPP_
+
+#if __cplusplus < 202002L
+#error "scheduler.hpp needs C++20 coroutines, build with -std=c++20"
+#endif
+
+#include "deadline.hpp"
+#include "trace.hpp"
+#include <stdint.h>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * A job written as a coroutine, to be run by a Scheduler
+ *
+ *     Task search(Scheduler &pScheduler, Player &pPlayer, GameState pState, Deadline pDue)
+ *     {
+ *         if (pPlayer.begin(pState, pDue))
+ *             while (!pPlayer.advance(256))
+ *                 co_await pScheduler.yield();
+ *         GameState lNext = pPlayer.result();
+ *         ...
+ *     }
+ *
+ *     lScheduler.spawn(search(lScheduler, lPlayer, lState, lDue), lDue);
+ *
+ * The coroutine does not start until it is spawned. Its parameters are
+ * copied into it, so anything taken by reference must outlive it.
+ */
+class Task
+{
+public:
+    struct promise_type
+    {
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept  {   return {};  }
+        std::suspend_always final_suspend() noexcept    {   return {};  }
+        void return_void()                              {}
+        void unhandled_exception()                      {   std::terminate();   }
+    };
+
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    Task(Task &&pOther)
+        :   mHandle(std::exchange(pOther.mHandle, nullptr))
+    {
+    }
+
+    ~Task()
+    {
+        if (mHandle)
+            mHandle.destroy();
+    }
+
+    Task(const Task&) = delete;
+    Task &operator=(const Task&) = delete;
+
+    ///hands the coroutine over to whoever runs it
+    Handle release()    {   return std::exchange(mHandle, nullptr);     }
+
+private:
+    explicit Task(Handle pHandle)
+        :   mHandle(pHandle)
+    {
+    }
+
+    Handle mHandle;
+};
+
+/**
+ * Runs many tasks on a few threads, the one with the earliest deadline first
+ *
+ * A task runs until it awaits yield() and then waits behind the tasks due
+ * before it, so that a search which yields every few hundred nodes shares
+ * the threads with the others instead of holding one for a whole move.
+ * With more games than cores, each move then gets the cores roughly in
+ * proportion to how soon it is due, and the process does not need a thread
+ * per game. yield() is the only thing a task may await.
+ *
+ * The deadlines of all the tasks must be on the same clock, and the tasks
+ * move between threads, so use Deadline::wallNow().
+ */
+class Scheduler
+{
+public:
+    ///starts \p pThreads threads
+    explicit Scheduler(int pThreads)
+    {
+        for (int t = 0; t < pThreads; ++t)
+            mThreads.push_back(std::thread(&Scheduler::run, this, t + 1));
+    }
+
+    ~Scheduler()
+    {
+        stop();
+    }
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler &operator=(const Scheduler&) = delete;
+
+    ///queues \p pTask to run by \p pDue
+    void spawn(Task pTask, const Deadline &pDue)
+    {
+        queue(pTask.release(), pDue);
+    }
+
+    ///awaited by a task to let the tasks due before it run
+    std::suspend_always yield()     {   return {};  }
+
+    ///lets the slices running finish, joins the threads and drops the tasks left
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lLock(mMutex);
+            mStop = true;
+        }
+        mWake.notify_all();
+        for (std::size_t t = 0; t < mThreads.size(); ++t)
+            mThreads[t].join();
+        mThreads.clear();
+        while (!mReady.empty())
+        {
+            mReady.top().mHandle.destroy();
+            mReady.pop();
+        }
+    }
+
+private:
+    struct Entry
+    {
+        Deadline mDue;
+        uint64_t mOrder;            ///< tasks due at the same time run in turn
+        Task::Handle mHandle;
+
+        bool operator<(const Entry &pOther) const
+        {
+            // std::priority_queue puts the greatest on top
+            if (mDue != pOther.mDue)
+                return mDue > pOther.mDue;
+            return mOrder > pOther.mOrder;
+        }
+    };
+
+    void queue(Task::Handle pHandle, const Deadline &pDue)
+    {
+        {
+            std::lock_guard<std::mutex> lLock(mMutex);
+            mReady.push(Entry{ pDue, mNext++, pHandle });
+        }
+        mWake.notify_one();
+    }
+
+    void run(int pIndex)
+    {
+        Trace::nameThread("scheduler " + std::to_string(pIndex));
+        for (;;)
+        {
+            Entry lEntry;
+            {
+                std::unique_lock<std::mutex> lLock(mMutex);
+                mWake.wait(lLock, [this]() { return mStop || !mReady.empty(); });
+                if (mStop)
+                    return;
+                lEntry = mReady.top();
+                mReady.pop();
+            }
+
+            {
+                TraceSpan lSpan("slice");
+                lEntry.mHandle.resume();
+            }
+            if (lEntry.mHandle.done())
+                lEntry.mHandle.destroy();
+            else
+                queue(lEntry.mHandle, lEntry.mDue);
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::priority_queue<Entry> mReady;
+    uint64_t mNext = 0;
+    bool mStop = false;
+    std::vector<std::thread> mThreads;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
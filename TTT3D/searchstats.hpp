@@ -0,0 +1,101 @@
+#ifndef _TICTACTOE3D_SEARCHSTATS_HPP_
+#define _TICTACTOE3D_SEARCHSTATS_HPP_
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/**
+ * Search statistics are only gathered when the program is built with
+ *
+ *     -DTTT_SEARCH_STATS=1
+ *
+ * Otherwise SEARCH_STAT() expands to nothing and the counters cost nothing.
+ */
+#ifndef TTT_SEARCH_STATS
+#define TTT_SEARCH_STATS 0
+#endif
+
+#if TTT_SEARCH_STATS
+#define SEARCH_STAT(pStatement) do { pStatement; } while (0)
+#else
+#define SEARCH_STAT(pStatement) do { } while (0)
+#endif
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Counters of one search
+ *
+ * Every searching thread owns its own Player and so its own counters; they
+ * are aligned to a cache line so that two of them never share one.
+ */
+struct alignas(64) SearchStats
+{
+    static const int cMaxPly = 64;
+
+    uint64_t mLeaves;           ///< nodes scored without looking further
+    uint64_t mEvaluations;      ///< calls to the evaluation
+    uint64_t mCutoffs;          ///< nodes left early because of a beta cutoff
+    uint64_t mFirstCutoffs;     ///< cutoffs caused by the first move tried
+    uint64_t mTTProbes;         ///< transposition table lookups
+    uint64_t mTTHits;           ///< lookups that found the position
+    uint64_t mTTStores;         ///< positions written to the table
+    uint64_t mExtensions;       ///< moves searched deeper than usual
+    uint64_t mReductions;       ///< moves searched less deep than usual
+    uint64_t mPlyNodes[cMaxPly];    ///< nodes at each distance from the root
+
+    SearchStats()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    SearchStats &operator+=(const SearchStats &pRH)
+    {
+        const uint64_t *lFrom = &pRH.mLeaves;
+        uint64_t *lTo = &mLeaves;
+        for (std::size_t i = 0; i < sizeof(SearchStats) / sizeof(uint64_t); ++i)
+            lTo[i] += lFrom[i];
+        return *this;
+    }
+
+    ///the counters as " name value" pairs, or as JSON members (",\"name\":value") if \p pJson
+    std::string format(bool pJson) const
+    {
+        std::string lOut;
+        char lBuffer[64];
+        const char *lFormat = pJson ? ",\"%s\":%llu" : "  %s %llu";
+        const struct { const char *mName; uint64_t mValue; } lCounters[] = {
+            { "leaves", mLeaves }, { "evals", mEvaluations }, { "cutoffs", mCutoffs },
+            { "first_cutoffs", mFirstCutoffs }, { "tt_probes", mTTProbes }, { "tt_hits", mTTHits },
+            { "tt_stores", mTTStores }, { "extensions", mExtensions }, { "reductions", mReductions } };
+        for (std::size_t i = 0; i < sizeof(lCounters) / sizeof(lCounters[0]); ++i)
+        {
+            snprintf(lBuffer, sizeof(lBuffer), lFormat, lCounters[i].mName, (unsigned long long)lCounters[i].mValue);
+            lOut += lBuffer;
+        }
+
+        // Branching factor between each ply and the next
+        lOut += pJson ? ",\"branching\":[" : "  branching";
+        for (int p = 0; p + 1 < cMaxPly && mPlyNodes[p + 1]; ++p)
+        {
+            snprintf(lBuffer, sizeof(lBuffer), "%s%.2f", pJson ? (p ? "," : "") : " ",
+                     (double)mPlyNodes[p + 1] / mPlyNodes[p]);
+            lOut += lBuffer;
+        }
+        if (pJson)
+            lOut += "]";
+        return lOut;
+    }
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -0,0 +1,178 @@
+#include "telemetry.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace TICTACTOE3D
+{
+
+void Histogram::clear()
+{
+    memset(mCounts, 0, sizeof(mCounts));
+    mCount = 0;
+    mSum = 0;
+    mMin = UINT64_MAX;
+    mMax = 0;
+}
+
+void Histogram::merge(const Histogram &pRH)
+{
+    for (int i = 0; i < cBuckets; ++i)
+        mCounts[i] += pRH.mCounts[i];
+    mCount += pRH.mCount;
+    mSum += pRH.mSum;
+    if (pRH.mMin < mMin)
+        mMin = pRH.mMin;
+    if (pRH.mMax > mMax)
+        mMax = pRH.mMax;
+}
+
+uint64_t Histogram::percentile(double pPercent) const
+{
+    if (mCount == 0)
+        return 0;
+    uint64_t lRank = (uint64_t)(pPercent / 100 * mCount);
+    if (lRank >= mCount)
+        lRank = mCount - 1;
+    uint64_t lSeen = 0;
+    for (int i = 0; i < cBuckets; ++i)
+    {
+        lSeen += mCounts[i];
+        if (lSeen > lRank)
+            return lowest(i);
+    }
+    return mMax;
+}
+
+void Histogram::toJson(std::string &pOut) const
+{
+    char lBuffer[256];
+    snprintf(lBuffer, sizeof(lBuffer),
+             "{\"count\":%llu,\"min\":%llu,\"max\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"buckets\":[",
+             (unsigned long long)mCount, (unsigned long long)min(), (unsigned long long)mMax, mean(),
+             (unsigned long long)percentile(50), (unsigned long long)percentile(90),
+             (unsigned long long)percentile(99), (unsigned long long)percentile(99.9));
+    pOut += lBuffer;
+
+    // [lowest value, count] of the buckets in use
+    bool lFirst = true;
+    for (int i = 0; i < cBuckets; ++i)
+        if (mCounts[i])
+        {
+            snprintf(lBuffer, sizeof(lBuffer), "%s[%llu,%llu]", lFirst ? "" : ",",
+                     (unsigned long long)lowest(i), (unsigned long long)mCounts[i]);
+            pOut += lBuffer;
+            lFirst = false;
+        }
+    pOut += "]}";
+}
+
+void MoveTelemetry::clear()
+{
+    mParse.clear();
+    mPlay.clear();
+    mOutput.clear();
+    mMargin.clear();
+    mOverruns = 0;
+}
+
+void MoveTelemetry::merge(const MoveTelemetry &pRH)
+{
+    mParse.merge(pRH.mParse);
+    mPlay.merge(pRH.mPlay);
+    mOutput.merge(pRH.mOutput);
+    mMargin.merge(pRH.mMargin);
+    mOverruns += pRH.mOverruns;
+}
+
+void MoveTelemetry::toJson(std::string &pOut) const
+{
+    char lBuffer[64];
+    snprintf(lBuffer, sizeof(lBuffer), "{\"overruns\":%llu,\"parse\":", (unsigned long long)mOverruns);
+    pOut += lBuffer;
+    mParse.toJson(pOut);
+    pOut += ",\"play\":";
+    mPlay.toJson(pOut);
+    pOut += ",\"output\":";
+    mOutput.toJson(pOut);
+    pOut += ",\"margin\":";
+    mMargin.toJson(pOut);
+    pOut += "}";
+}
+
+namespace
+{
+
+// Two buffers, so that a signal never sees one that is being written
+char sFile[1024];
+std::vector<char> sText[2];
+volatile sig_atomic_t sCurrent = -1;
+
+void writeOut()
+{
+#ifndef _WIN32
+    int lCurrent = sCurrent;
+    if (lCurrent < 0 || !sFile[0])
+        return;
+    const std::vector<char> &lText = sText[lCurrent];
+    int lFd = open(sFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (lFd < 0)
+        return;
+    std::size_t lDone = 0;
+    while (lDone < lText.size())
+    {
+        ssize_t lWritten = write(lFd, &lText[lDone], lText.size() - lDone);
+        if (lWritten <= 0)
+            break;
+        lDone += lWritten;
+    }
+    close(lFd);
+#endif
+}
+
+void onExit()
+{
+    writeOut();
+}
+
+void onSignal(int pSignal)
+{
+    writeOut();
+#ifndef _WIN32
+    if (pSignal == SIGUSR1)
+        return;
+#endif
+    signal(pSignal, SIG_DFL);
+    raise(pSignal);
+}
+
+/*namespace*/ }
+
+bool TelemetryDump::install(const std::string &pFile)
+{
+    if (pFile.size() >= sizeof(sFile))
+        return false;
+    strcpy(sFile, pFile.c_str());
+    atexit(onExit);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+#ifndef _WIN32
+    signal(SIGUSR1, onSignal);
+#endif
+    return true;
+}
+
+void TelemetryDump::publish(const std::string &pJson)
+{
+    int lNext = (sCurrent == 0) ? 1 : 0;
+    sText[lNext].assign(pJson.begin(), pJson.end());
+    sCurrent = lNext;
+}
+
+/*namespace TICTACTOE3D*/ }
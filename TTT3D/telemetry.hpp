@@ -0,0 +1,126 @@
+#ifndef _TICTACTOE3D_TELEMETRY_HPP_
+#define _TICTACTOE3D_TELEMETRY_HPP_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Histogram of non-negative values with a bounded relative error, in the
+ * manner of HdrHistogram
+ *
+ * Values below 2^cSubBits have a bucket each. Above that, every power of
+ * two is split into 2^(cSubBits-1) buckets, so a value is known to within
+ * 1 part in 64 whatever its size. Recording is a few instructions and
+ * never allocates.
+ */
+class Histogram
+{
+public:
+    static const int cSubBits = 7;
+    static const int cHalf = 1 << (cSubBits - 1);
+    static const int cBuckets = (1 << cSubBits) + (64 - cSubBits) * cHalf;
+
+    Histogram()
+    {
+        clear();
+    }
+
+    void clear();
+
+    void record(uint64_t pValue)
+    {
+        ++mCounts[index(pValue)];
+        ++mCount;
+        mSum += pValue;
+        if (pValue < mMin)
+            mMin = pValue;
+        if (pValue > mMax)
+            mMax = pValue;
+    }
+
+    ///adds the values of \p pRH
+    void merge(const Histogram &pRH);
+
+    uint64_t count() const      {   return mCount;  }
+    uint64_t min() const        {   return mCount ? mMin : 0;   }
+    uint64_t max() const        {   return mMax;    }
+    double mean() const         {   return mCount ? (double)mSum / mCount : 0;  }
+
+    ///returns the value below which \p pPercent % of the values fall (the lowest value of its bucket)
+    uint64_t percentile(double pPercent) const;
+
+    ///appends the histogram as a JSON object: summary values and the non-empty buckets
+    void toJson(std::string &pOut) const;
+
+    ///returns the bucket of \p pValue
+    static int index(uint64_t pValue)
+    {
+        if (pValue < (uint64_t(1) << cSubBits))
+            return (int)pValue;
+        int lShift = 63 - __builtin_clzll(pValue) - cSubBits + 1;
+        return (1 << cSubBits) + (lShift - 1) * cHalf + (int)(pValue >> lShift) - cHalf;
+    }
+
+    ///returns the lowest value of bucket \p pIndex
+    static uint64_t lowest(int pIndex)
+    {
+        if (pIndex < (1 << cSubBits))
+            return pIndex;
+        int lRest = pIndex - (1 << cSubBits);
+        return (uint64_t)(lRest % cHalf + cHalf) << (lRest / cHalf + 1);
+    }
+
+private:
+    uint64_t mCounts[cBuckets];
+    uint64_t mCount;
+    uint64_t mSum;
+    uint64_t mMin;
+    uint64_t mMax;
+};
+
+/**
+ * Timings of the moves played by the driver, all in nanoseconds
+ */
+struct MoveTelemetry
+{
+    Histogram mParse;       ///< reading the state received
+    Histogram mPlay;        ///< Player::play
+    Histogram mOutput;      ///< formatting and sending the answer
+    Histogram mMargin;      ///< time left before the deadline when play() returned
+    uint64_t mOverruns;     ///< moves that returned after the deadline
+
+    MoveTelemetry()
+        :   mOverruns(0)
+    {
+    }
+
+    void clear();
+    void merge(const MoveTelemetry &pRH);
+    void toJson(std::string &pOut) const;
+};
+
+/**
+ * Writes telemetry to a file when the process exits or gets a signal
+ *
+ * The JSON is built by the program with publish() whenever it changes; on
+ * exit, SIGINT, SIGTERM or SIGUSR1 the last published text is written to
+ * the file with async-signal-safe calls only. SIGINT and SIGTERM then end
+ * the process as they would have, SIGUSR1 lets it go on.
+ */
+class TelemetryDump
+{
+public:
+    ///sets the file and installs the exit and signal handlers, returns false if \p pFile is too long
+    static bool install(const std::string &pFile);
+
+    ///makes \p pJson the text written out on exit or on a signal
+    static void publish(const std::string &pJson);
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
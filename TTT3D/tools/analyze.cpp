@@ -0,0 +1,296 @@
+// Searches every position of a file and writes the results, in the order
+// of the file.
+//
+// The positions are either toMessage() lines or a position file of
+// positions.hpp (told apart by its magic). They are shared out to a pool
+// of threads, each searching to the same fixed depth or node budget. A
+// thread keeps its engines, and so their transposition tables, from one
+// position to the next: one engine for the positions X is to move in and
+// one for O, as the table only keeps the values of one side. A thread
+// never waits for another, so the speed grows with the cores. Which thread
+// gets a position, and so what its table holds, changes from run to run:
+// for results that do not depend on threads=, pass clear=on (or hash=0).
+//
+// Each output line is the position, the cell of the best move (-1 if there
+// is none), its score for the side to move, the depth completed and the
+// nodes searched:
+//     <toMessage()> <cell> <score> <depth> <nodes>
+// With eval=on the line score of the position itself (LineEvaluator, for
+// the side to move) follows the nodes. With multipv=K the K best moves
+// follow, best first, each as its score and the cells of its line:
+//     <score>:<cell>,<cell>,...
+// A line that is not a position is written back followed by "invalid".
+//
+// Usage: analyze positions=FILE [name=value ...]
+//   positions=FILE the positions
+//   out=FILE       where to write the results (default: standard output)
+//   depth=N        search every position to depth N (default 3)
+//   nodes=N        and give up a depth after N nodes (default 0: no limit)
+//   multipv=K      score the K best moves of each position exactly (default 1)
+//   eval=on        add the static line score of each position (default off)
+//   threads=N      searching threads (default: all cores)
+//   hash=MB        transposition table of each engine (default 4)
+// Any other name=value is passed on to the engines (see Player::configure).
+
+#include "engine.hpp"
+#include "lineeval.hpp"
+#include "positions.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+struct Options
+{
+    std::string mPositions;
+    std::string mOut;
+    int mDepth = 3;
+    uint64_t mNodes = 0;
+    int mMultiPV = 1;
+    bool mEval = false;
+    int mThreads = std::max(1u, std::thread::hardware_concurrency());
+    int mHash = 4;
+    std::vector<std::string> mEngine;
+};
+
+///the positions and their results, written in order as they come in
+struct Batch
+{
+    std::vector<std::string> mLines;        ///< the position, then its result line
+    std::vector<char> mDone;
+    std::atomic<std::size_t> mNext{0};      ///< next position to search
+    std::atomic<uint64_t> mNodes{0};
+    std::mutex mMutex;
+    std::condition_variable mReady;
+};
+
+bool isPositionFile(const std::string &pFile)
+{
+    std::ifstream lFile(pFile.c_str(), std::ios::binary);
+    char lMagic[8];
+    return lFile.read(lMagic, sizeof(lMagic)) && memcmp(lMagic, "TTT3POS1", sizeof(lMagic)) == 0;
+}
+
+bool readPositions(const std::string &pFile, std::vector<std::string> &pLines)
+{
+    if (isPositionFile(pFile))
+    {
+        // The file has no last move; the side to move follows from the stones
+        std::vector<LabelledPosition> lPositions;
+        if (!PositionFile::read(pFile, lPositions))
+            return false;
+        pLines.reserve(lPositions.size());
+        char lBuffer[GameState::cMaxMessage];
+        for (std::size_t i = 0; i < lPositions.size(); ++i)
+        {
+            const LabelledPosition &lPosition = lPositions[i];
+            uint8_t lNext = __builtin_popcountll(lPosition.mX) > __builtin_popcountll(lPosition.mO) ? CELL_O : CELL_X;
+            GameState lState(lPosition.mX, lPosition.mO, Move(), lNext);
+            pLines.push_back(std::string(lBuffer, lState.format(lBuffer) - lBuffer));
+        }
+        return true;
+    }
+
+    std::ifstream lFile(pFile.c_str());
+    if (!lFile)
+    {
+        std::cerr << "Cannot open position file '" << pFile << "'" << std::endl;
+        return false;
+    }
+    std::string lLine;
+    while (std::getline(lFile, lLine))
+    {
+        if (!lLine.empty() && lLine.back() == '\r')
+            lLine.pop_back();
+        if (!lLine.empty() && lLine[0] != '#')
+            pLines.push_back(lLine);
+    }
+    return true;
+}
+
+///the position of \p pLine in \p pState, false if it is not one
+bool readPosition(const std::string &pLine, GameState &pState)
+{
+    if (!GameState::hasMessageShape(pLine))
+        return false;
+    pState = GameState(pLine);
+    return pState.toMessage() == pLine;
+}
+
+///the result line of the position \p pLine, searched by the engine of the side to move,
+///with its static score by \p pEval unless it is null
+std::string analyze(Engine (&pEngines)[2], const std::string &pLine, const Engine::Limits &pLimits,
+                    const LineEvaluator *pEval, uint64_t &pNodes)
+{
+    GameState lState;
+    if (!readPosition(pLine, lState))
+        return pLine + " invalid";
+
+    Engine &lEngine = pEngines[lState.getNextPlayer() == CELL_X ? 0 : 1];
+    Engine::Analysis lAnalysis = lEngine.analyze(lState, pLimits);
+    pNodes += lAnalysis.mNodes;
+    char lBuffer[96];
+    snprintf(lBuffer, sizeof(lBuffer), " %d %g %d %llu", lAnalysis.mCell, lAnalysis.mScore, lAnalysis.mDepth,
+             (unsigned long long)lAnalysis.mNodes);
+    std::string lResult = pLine + lBuffer;
+    if (pEval)
+    {
+        // The line score is seen from X
+        int lEval = pEval->evaluate(lState);
+        lResult += " " + std::to_string(lState.getNextPlayer() == CELL_X ? lEval : -lEval);
+    }
+    if (pLimits.mMultiPV > 1)
+        for (std::size_t l = 0; l < lAnalysis.mLines.size(); ++l)
+        {
+            const Player::Line &lLine = lAnalysis.mLines[l];
+            snprintf(lBuffer, sizeof(lBuffer), " %g:", lLine.mScore);
+            lResult += lBuffer;
+            for (std::size_t m = 0; m < lLine.mPv.size(); ++m)
+            {
+                snprintf(lBuffer, sizeof(lBuffer), m ? ",%d" : "%d", lLine.mPv[m]);
+                lResult += lBuffer;
+            }
+        }
+    return lResult;
+}
+
+void work(Batch &pBatch, const Engine &pPrototype, const Engine::Limits &pLimits, bool pEval)
+{
+    LineEvaluator lEvaluator;
+    // The table of an engine only holds values for one side to move
+    Engine lEngines[2] = { pPrototype, pPrototype };
+    uint64_t lNodes = 0;
+    for (;;)
+    {
+        std::size_t lIndex = pBatch.mNext.fetch_add(1, std::memory_order_relaxed);
+        if (lIndex >= pBatch.mLines.size())
+            break;
+        std::string lResult = analyze(lEngines, pBatch.mLines[lIndex], pLimits, pEval ? &lEvaluator : nullptr, lNodes);
+
+        std::lock_guard<std::mutex> lLock(pBatch.mMutex);
+        pBatch.mLines[lIndex].swap(lResult);
+        pBatch.mDone[lIndex] = 1;
+        pBatch.mReady.notify_one();
+    }
+    pBatch.mNodes += lNodes;
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "positions")
+            pOptions.mPositions = lValue;
+        else if (lName == "out")
+            pOptions.mOut = lValue;
+        else if (lName == "depth")
+            pOptions.mDepth = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "nodes")
+            pOptions.mNodes = strtoull(lValue.c_str(), nullptr, 10);
+        else if (lName == "multipv")
+            pOptions.mMultiPV = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "eval" && (lValue == "on" || lValue == "off"))
+            pOptions.mEval = (lValue == "on");
+        else if (lName == "threads")
+            pOptions.mThreads = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "hash")
+            pOptions.mHash = std::max(0, atoi(lValue.c_str()));
+        else if (lEqual != std::string::npos)
+            pOptions.mEngine.push_back(lArg);
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    if (pOptions.mPositions.empty())
+    {
+        std::cerr << "No positions given (positions=FILE)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    // The engines of the threads are copies of this one; a summary per position would flood the output
+    Engine lPrototype;
+    lOptions.mEngine.insert(lOptions.mEngine.begin(), "stats=off");
+    lOptions.mEngine.push_back("hash=" + std::to_string(lOptions.mHash));
+    for (std::size_t i = 0; i < lOptions.mEngine.size(); ++i)
+        if (!lPrototype.configure(lOptions.mEngine[i]))
+        {
+            std::cerr << "Invalid option: '" << lOptions.mEngine[i] << "'" << std::endl;
+            return -1;
+        }
+    Engine::Limits lLimits;
+    lLimits.mDepth = lOptions.mDepth;
+    lLimits.mNodes = lOptions.mNodes;
+    lLimits.mMultiPV = lOptions.mMultiPV;
+
+    Batch lBatch;
+    if (!readPositions(lOptions.mPositions, lBatch.mLines))
+        return -1;
+    lBatch.mDone.assign(lBatch.mLines.size(), 0);
+
+    FILE *lOut = lOptions.mOut.empty() ? stdout : fopen(lOptions.mOut.c_str(), "w");
+    if (!lOut)
+    {
+        std::cerr << "Cannot write '" << lOptions.mOut << "'" << std::endl;
+        return -1;
+    }
+
+    std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> lThreads;
+    for (int t = 0; t < lOptions.mThreads; ++t)
+        lThreads.push_back(std::thread(work, std::ref(lBatch), std::cref(lPrototype), std::cref(lLimits), lOptions.mEval));
+
+    // Write each result as soon as those before it are written, and let go of it
+    for (std::size_t i = 0; i < lBatch.mLines.size(); ++i)
+    {
+        std::string lLine;
+        {
+            std::unique_lock<std::mutex> lLock(lBatch.mMutex);
+            lBatch.mReady.wait(lLock, [&]() { return lBatch.mDone[i] != 0; });
+            lLine.swap(lBatch.mLines[i]);
+        }
+        lLine += '\n';
+        fwrite(lLine.data(), 1, lLine.size(), lOut);
+    }
+    for (std::size_t t = 0; t < lThreads.size(); ++t)
+        lThreads[t].join();
+    double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+
+    bool lOk = !ferror(lOut);
+    if (lOut != stdout)
+        lOk = (fclose(lOut) == 0) && lOk;
+    else
+        fflush(lOut);
+    std::cerr << lBatch.mLines.size() << " positions in " << lSeconds << " s, "
+              << lBatch.mLines.size() / std::max(lSeconds, 1e-9) << " positions/s, "
+              << lBatch.mNodes / std::max(lSeconds, 1e-9) << " nodes/s" << std::endl;
+    return lOk ? 0 : -1;
+}
@@ -0,0 +1,385 @@
+// Plays two engine configurations against each other in-process.
+//
+// Each configuration is a list of Player options ("name=value", see
+// Player::configure) separated by spaces. Every opening is played twice,
+// once with each engine moving first. The games run on a pool of threads,
+// each thread holding its own pair of players, and are scored from the
+// point of view of engine A.
+//
+// After every game pair the sequential probability ratio test of elo0
+// against elo1 is updated, and the match stops as soon as one of them is
+// accepted (or when the games run out). The two games of a pair share
+// their opening and are not independent, so the test counts pairs, by the
+// points A scored in them (0, 1/2, 1, 3/2 or 2: the pentanomial results),
+// and not games; so does the error margin of the Elo. The pairs are scored in the order
+// of their openings, whichever thread finishes first, and every game starts
+// from empty transposition tables: with players that search to a fixed
+// depth or node budget, the score and the decision do not depend on the
+// number of threads. Only the order of the recorded games does.
+//
+// Usage: arena [name=value ...]
+//   a="OPTIONS"    options of engine A (default: none)
+//   b="OPTIONS"    options of engine B (default: none)
+//   openings=FILE  starting positions, one toMessage() line each
+//   random=N       without an opening file, start from N random plies (default 2)
+//   games=N        maximum number of games (default 10000)
+//   threads=N      worker threads (default: all cores)
+//   elo0=X elo1=X  SPRT hypotheses, in Elo (default 0 and 10)
+//   alpha=X beta=X SPRT error rates (default 0.05 both)
+//   seed=N         random seed for the random openings (default 1)
+//   record=FILE    append the games to FILE (see gamerecord.hpp)
+//   trace=FILE     write a Chrome trace of the last games of every thread to FILE
+
+#include "player.hpp"
+#include "gamerecord.hpp"
+#include "trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+struct Options
+{
+    std::string mA;
+    std::string mB;
+    std::string mOpenings;
+    int mRandom = 2;
+    long mGames = 10000;
+    int mThreads = std::max(1u, std::thread::hardware_concurrency());
+    double mElo0 = 0;
+    double mElo1 = 10;
+    double mAlpha = 0.05;
+    double mBeta = 0.05;
+    unsigned mSeed = 1;
+    std::string mRecord;
+    std::string mTrace;
+};
+
+///results seen from engine A
+struct Score
+{
+    long mWins = 0;
+    long mDraws = 0;
+    long mLosses = 0;
+    long mPairs[5] = {};        ///< finished game pairs by the half points A scored in them
+
+    long games() const          {   return mWins + mDraws + mLosses;    }
+    double mean() const         {   return (mWins + 0.5 * mDraws) / std::max(games(), 1L);    }
+
+    long pairs() const          {   return mPairs[0] + mPairs[1] + mPairs[2] + mPairs[3] + mPairs[4];   }
+
+    ///mean score per game over the finished pairs
+    double pairMean() const
+    {
+        double lSum = 0;
+        for (int p = 0; p < 5; ++p)
+            lSum += mPairs[p] * p / 4.0;
+        return lSum / std::max(pairs(), 1L);
+    }
+
+    ///variance of the score per game of one pair
+    double pairVariance() const
+    {
+        double lMean = pairMean();
+        double lSum = 0;
+        for (int p = 0; p < 5; ++p)
+            lSum += mPairs[p] * (p / 4.0 - lMean) * (p / 4.0 - lMean);
+        return lSum / std::max(pairs(), 1L);
+    }
+};
+
+double toElo(double pScore)
+{
+    pScore = std::min(std::max(pScore, 1e-6), 1 - 1e-6);
+    return 400 * std::log10(pScore / (1 - pScore));
+}
+
+double fromElo(double pElo)
+{
+    return 1 / (1 + std::pow(10.0, -pElo / 400));
+}
+
+///log-likelihood ratio of elo1 against elo0, with the normal approximation of the pair results
+double llr(const Score &pScore, double pElo0, double pElo1)
+{
+    double lVariance = pScore.pairVariance();
+    if (pScore.pairs() < 2 || lVariance <= 0)
+        return 0;
+    double lS0 = fromElo(pElo0);
+    double lS1 = fromElo(pElo1);
+    return pScore.pairs() * (lS1 - lS0) * (2 * pScore.pairMean() - lS0 - lS1) / (2 * lVariance);
+}
+
+bool configure(Player &pPlayer, const std::string &pOptions)
+{
+    std::istringstream lStream(pOptions);
+    std::string lOption;
+    while (lStream >> lOption)
+        if (!pPlayer.configure(lOption))
+        {
+            std::cerr << "Bad engine option: '" << lOption << "'" << std::endl;
+            return false;
+        }
+    return true;
+}
+
+bool readOpenings(const std::string &pFile, std::vector<GameState> &pOpenings)
+{
+    std::ifstream lFile(pFile.c_str());
+    if (!lFile)
+    {
+        std::cerr << "Cannot open opening file '" << pFile << "'" << std::endl;
+        return false;
+    }
+    std::string lLine;
+    while (std::getline(lFile, lLine))
+    {
+        if (lLine.empty() || lLine[0] == '#')
+            continue;
+        GameState lState(lLine);
+        if (lState.isEOG())
+            continue;
+        pOpenings.push_back(lState);
+    }
+    return true;
+}
+
+///draws openings of \p pPlies random moves that do not end the game
+void randomOpenings(int pPlies, long pCount, unsigned pSeed, std::vector<GameState> &pOpenings)
+{
+    std::mt19937 lRandom(pSeed);
+    std::vector<GameState> lChildren;
+    while ((long)pOpenings.size() < pCount)
+    {
+        GameState lState;
+        for (int p = 0; p < pPlies && !lState.isEOG(); ++p)
+        {
+            lState.findPossibleMoves(lChildren);
+            lState = lChildren[lRandom() % lChildren.size()];
+        }
+        if (!lState.isEOG())
+            pOpenings.push_back(lState);
+    }
+}
+
+///plays one game from \p pOpening into \p pRecord, returns 1 if A won, -1 if B won, 0 for a draw
+int playGame(Player &pA, Player &pB, const GameState &pOpening, bool pAIsX, GameRecord &pRecord)
+{
+    // The arena has no clock, the players search to their fixed depth
+    Deadline lDue(get_cpu_time() + 1e9);
+    GameState lState = pOpening;
+    pA.clearTable();
+    pB.clearTable();
+    pRecord.start(pOpening);
+    while (!lState.isEOG())
+    {
+        bool lXToMove = (lState.getNextPlayer() == CELL_X);
+        Player &lPlayer = (lXToMove == pAIsX) ? pA : pB;
+        std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+        lState = lPlayer.play(lState, lDue);
+        double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+
+        MoveInfo lInfo;
+        lInfo.mScore = (float)lPlayer.getLastScore();
+        lInfo.mDepth = (uint16_t)lPlayer.getLastDepth();
+        lInfo.mTime = (uint16_t)std::min(lSeconds * 1e4, 65535.0);
+        pRecord.add(lState, lInfo);
+    }
+    if (lState.isDraw())
+        return 0;
+    return (lState.isXWin() == pAIsX) ? 1 : -1;
+}
+
+void report(const char *pWhat, const Score &pScore, const Options &pOptions, double pSeconds)
+{
+    double lMean = pScore.mean();
+    double lError = 1.96 * std::sqrt(pScore.pairVariance() / std::max(pScore.pairs(), 1L));
+    double lElo = toElo(lMean);
+    double lMargin = (toElo(lMean + lError) - toElo(lMean - lError)) / 2;
+    std::cout << pWhat << " games " << pScore.games() << "  W " << pScore.mWins << "  D " << pScore.mDraws
+              << "  L " << pScore.mLosses << "  score " << lMean << "  Elo " << lElo << " +/- " << lMargin
+              << "  LLR " << llr(pScore, pOptions.mElo0, pOptions.mElo1)
+              << "  (" << (long)(pScore.games() / std::max(pSeconds, 1e-9)) << " games/s)" << std::endl;
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "a")
+            pOptions.mA = lValue;
+        else if (lName == "b")
+            pOptions.mB = lValue;
+        else if (lName == "openings")
+            pOptions.mOpenings = lValue;
+        else if (lName == "random")
+            pOptions.mRandom = std::max(0, atoi(lValue.c_str()));
+        else if (lName == "games")
+            pOptions.mGames = atol(lValue.c_str());
+        else if (lName == "threads")
+            pOptions.mThreads = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "elo0")
+            pOptions.mElo0 = atof(lValue.c_str());
+        else if (lName == "elo1")
+            pOptions.mElo1 = atof(lValue.c_str());
+        else if (lName == "alpha")
+            pOptions.mAlpha = atof(lValue.c_str());
+        else if (lName == "beta")
+            pOptions.mBeta = atof(lValue.c_str());
+        else if (lName == "seed")
+            pOptions.mSeed = (unsigned)atol(lValue.c_str());
+        else if (lName == "record")
+            pOptions.mRecord = lValue;
+        else if (lName == "trace")
+            pOptions.mTrace = lValue;
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    // Check the configurations once before starting the workers
+    {
+        Player lA, lB;
+        if (!configure(lA, lOptions.mA) || !configure(lB, lOptions.mB))
+            return -1;
+    }
+
+    std::vector<GameState> lOpenings;
+    if (!lOptions.mOpenings.empty())
+    {
+        if (!readOpenings(lOptions.mOpenings, lOpenings))
+            return -1;
+    }
+    else
+        randomOpenings(lOptions.mRandom, (lOptions.mGames + 1) / 2, lOptions.mSeed, lOpenings);
+    if (lOpenings.empty())
+    {
+        std::cerr << "No openings to play" << std::endl;
+        return -1;
+    }
+
+    GameRecordWriter lRecorder(true);
+    if (!lOptions.mRecord.empty() && !lRecorder.open(lOptions.mRecord))
+        return -1;
+
+    const double lLower = std::log(lOptions.mBeta / (1 - lOptions.mAlpha));
+    const double lUpper = std::log((1 - lOptions.mBeta) / lOptions.mAlpha);
+
+    std::atomic<long> lNextPair(0);
+    std::atomic<bool> lStop(false);
+    std::mutex lMutex;
+    Score lScore;
+    std::map<long, std::pair<int, int>> lFinished;   ///< the pairs waiting for those before them
+    long lNextScored = 0;
+    int lDecision = 0;
+    std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+
+    if (!lOptions.mTrace.empty())
+        Trace::enable();
+
+    std::vector<std::thread> lWorkers;
+    for (int w = 0; w < lOptions.mThreads; ++w)
+        lWorkers.push_back(std::thread([&, w]()
+        {
+            Trace::nameThread("worker " + std::to_string(w + 1));
+            Player lA, lB;
+            configure(lA, lOptions.mA);
+            configure(lB, lOptions.mB);
+            GameRecord lGames[2];
+            while (!lStop)
+            {
+                long lPair = lNextPair++;
+                if (2 * lPair >= lOptions.mGames)
+                    break;
+                const GameState &lOpening = lOpenings[lPair % lOpenings.size()];
+                TraceSpan lSpan("game pair", "pair", lPair);
+                int lFirst = playGame(lA, lB, lOpening, true, lGames[0]);
+                lRecorder.write(lGames[0]);
+                int lSecond = 2;
+                if (2 * lPair + 1 < lOptions.mGames)
+                {
+                    lSecond = playGame(lA, lB, lOpening, false, lGames[1]);
+                    lRecorder.write(lGames[1]);
+                }
+
+                // Includes the wait for the other workers
+                TraceSpan lScoring("score");
+                std::lock_guard<std::mutex> lLock(lMutex);
+                lFinished[lPair] = std::make_pair(lFirst, lSecond);
+
+                // Once decided, the pairs after the deciding one do not count
+                for (auto i = lFinished.begin(); i != lFinished.end() && i->first == lNextScored;
+                     i = lFinished.erase(i), ++lNextScored)
+                {
+                    if (lDecision != 0)
+                        continue;
+                    for (int lResult : { i->second.first, i->second.second })
+                    {
+                        if (lResult == 1)
+                            ++lScore.mWins;
+                        else if (lResult == 0)
+                            ++lScore.mDraws;
+                        else if (lResult == -1)
+                            ++lScore.mLosses;
+                    }
+                    // A game without its pair, the last of an odd games=N, only counts in the totals
+                    if (i->second.second != 2)
+                        ++lScore.mPairs[i->second.first + i->second.second + 2];
+                    double lLlr = llr(lScore, lOptions.mElo0, lOptions.mElo1);
+                    if (lLlr >= lUpper || lLlr <= lLower)
+                    {
+                        lDecision = (lLlr >= lUpper) ? 1 : -1;
+                        lStop = true;
+                    }
+                    if (lScore.games() % 100 == 0)
+                        report("  ", lScore, lOptions,
+                               std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count());
+                }
+            }
+        }));
+    for (std::size_t w = 0; w < lWorkers.size(); ++w)
+        lWorkers[w].join();
+
+    if (!lOptions.mTrace.empty() && !Trace::write(lOptions.mTrace))
+        std::cerr << "Cannot write '" << lOptions.mTrace << "'" << std::endl;
+    if (!lRecorder.close())
+        std::cerr << "Could not write all the games to '" << lOptions.mRecord << "'" << std::endl;
+    report("Final:", lScore, lOptions, std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count());
+    if (lDecision > 0)
+        std::cout << "SPRT: H1 accepted (elo1 = " << lOptions.mElo1 << ")" << std::endl;
+    else if (lDecision < 0)
+        std::cout << "SPRT: H0 accepted (elo0 = " << lOptions.mElo0 << ")" << std::endl;
+    else
+        std::cout << "SPRT: no decision, bounds [" << lLower << ", " << lUpper << "]" << std::endl;
+    return 0;
+}
@@ -0,0 +1,224 @@
+// Searches a fixed suite of positions and reports the speed of the search.
+//
+// Each position is searched from scratch, either to a fixed depth (the
+// default) or for a fixed time. The report gives the nodes, nodes/s, the
+// time taken to complete each depth, the effective branching factor (nodes
+// of the last depth over nodes of the one before) and a signature: a hash
+// of the node count of every position. At a fixed depth the signature only
+// changes when the search itself does, so a change meant to be a pure
+// speed-up must keep it.
+//
+// tools/bench.cpp of the 2D board reports the same numbers the same way;
+// here the engine deepens the search itself (see Player::play), so every
+// position is a single play() and a timed search stops inside a depth.
+//
+// Usage: bench [name=value ...]
+//   positions=FILE the suite, one toMessage() line each (default tools/bench.txt)
+//   depth=N        search every position to depth N (default 3)
+//   time=S         search every position for S seconds instead
+//   json=FILE      also write the results as JSON ("-" for standard output)
+// Any other name=value is passed on to the engine (see Player::configure).
+
+#include "player.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+struct Options
+{
+    std::string mPositions = "tools/bench.txt";
+    int mDepth = 3;
+    double mTime = 0;
+    std::string mJson;
+    std::vector<std::string> mEngine;
+};
+
+struct Result
+{
+    uint64_t mNodes;
+    double mSeconds;
+    std::vector<Player::Iteration> mIterations;
+};
+
+///FNV-1a over the node counts
+uint64_t signature(const std::vector<Result> &pResults)
+{
+    uint64_t lHash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < pResults.size(); ++i)
+        for (int b = 0; b < 8; ++b)
+        {
+            lHash ^= (pResults[i].mNodes >> (8 * b)) & 0xff;
+            lHash *= 1099511628211ull;
+        }
+    return lHash;
+}
+
+bool readPositions(const std::string &pFile, std::vector<std::string> &pPositions)
+{
+    std::ifstream lFile(pFile.c_str());
+    if (!lFile)
+    {
+        std::cerr << "Cannot open position file '" << pFile << "'" << std::endl;
+        return false;
+    }
+    std::string lLine;
+    while (std::getline(lFile, lLine))
+        if (!lLine.empty() && lLine[0] != '#')
+            pPositions.push_back(lLine);
+    return true;
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "positions")
+            pOptions.mPositions = lValue;
+        else if (lName == "depth")
+            pOptions.mDepth = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "time")
+            pOptions.mTime = atof(lValue.c_str());
+        else if (lName == "json")
+            pOptions.mJson = lValue;
+        else if (lEqual != std::string::npos)
+            pOptions.mEngine.push_back(lArg);
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    std::vector<std::string> lPositions;
+    if (!readPositions(lOptions.mPositions, lPositions))
+        return -1;
+
+    // A timed search goes as deep as the time allows
+    Player lPlayer;
+    std::ostringstream lDepth;
+    lDepth << "depth=" << (lOptions.mTime > 0 ? GameState::cSquares : lOptions.mDepth);
+    lOptions.mEngine.insert(lOptions.mEngine.begin(), lDepth.str());
+    for (std::size_t i = 0; i < lOptions.mEngine.size(); ++i)
+        if (!lPlayer.configure(lOptions.mEngine[i]))
+        {
+            std::cerr << "Invalid option: '" << lOptions.mEngine[i] << "'" << std::endl;
+            return -1;
+        }
+
+    std::vector<Result> lResults;
+    for (std::size_t p = 0; p < lPositions.size(); ++p)
+    {
+        GameState lState(lPositions[p]);
+
+        Deadline lDue = (lOptions.mTime > 0) ? Deadline::now() + lOptions.mTime : Deadline();
+        std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+        lPlayer.play(lState, lDue);
+        double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+
+        Result lResult = { lPlayer.getLastNodes(), lSeconds, lPlayer.getIterations() };
+        lResults.push_back(lResult);
+        printf("%3d  depth %2d  %12llu nodes  %9.4f s  %12.0f nodes/s\n", (int)p + 1,
+               lResult.mIterations.empty() ? 0 : lResult.mIterations.back().mDepth,
+               (unsigned long long)lResult.mNodes, lSeconds, lResult.mNodes / std::max(lSeconds, 1e-9));
+    }
+
+    // Totals, and per depth the time to complete it
+    uint64_t lNodes = 0;
+    double lSeconds = 0;
+    std::vector<double> lTimeTo;
+    std::vector<int> lReached;
+    uint64_t lLastNodes = 0, lPreviousNodes = 0;
+    for (std::size_t p = 0; p < lResults.size(); ++p)
+    {
+        lNodes += lResults[p].mNodes;
+        lSeconds += lResults[p].mSeconds;
+        const std::vector<Player::Iteration> &lIterations = lResults[p].mIterations;
+        for (std::size_t i = 0; i < lIterations.size(); ++i)
+        {
+            if (lTimeTo.size() <= i)
+            {
+                lTimeTo.push_back(0);
+                lReached.push_back(0);
+            }
+            lTimeTo[i] += lIterations[i].mSeconds;
+            ++lReached[i];
+        }
+
+        // The branching factor compares the last two depths each position completed
+        std::size_t lLast = lIterations.size();
+        if (lLast >= 2)
+        {
+            lLastNodes += lIterations[lLast - 1].mNodes - lIterations[lLast - 2].mNodes;
+            lPreviousNodes += lIterations[lLast - 2].mNodes - (lLast >= 3 ? lIterations[lLast - 3].mNodes : 0);
+        }
+    }
+    double lEbf = lPreviousNodes ? (double)lLastNodes / lPreviousNodes : 0;
+    double lNps = lNodes / std::max(lSeconds, 1e-9);
+    uint64_t lSignature = signature(lResults);
+
+    printf("\ntime to depth:\n");
+    for (std::size_t i = 0; i < lTimeTo.size(); ++i)
+        printf("  depth %2d  %9.4f s average over %d positions\n", (int)i + 1, lTimeTo[i] / lReached[i], lReached[i]);
+    printf("\npositions  %d\nnodes      %llu\ntime       %.4f s\nnodes/s    %.0f\nEBF        %.3f\nsignature  %016llx\n",
+           (int)lResults.size(), (unsigned long long)lNodes, lSeconds, lNps, lEbf, (unsigned long long)lSignature);
+
+    if (!lOptions.mJson.empty())
+    {
+        std::ostringstream lJson;
+        lJson << "{\n  \"mode\": \"" << (lOptions.mTime > 0 ? "time" : "depth") << "\",\n"
+              << "  \"limit\": " << (lOptions.mTime > 0 ? lOptions.mTime : lOptions.mDepth) << ",\n"
+              << "  \"positions\": " << lResults.size() << ",\n"
+              << "  \"nodes\": " << lNodes << ",\n"
+              << "  \"seconds\": " << lSeconds << ",\n"
+              << "  \"nps\": " << (uint64_t)lNps << ",\n"
+              << "  \"ebf\": " << lEbf << ",\n";
+        char lHex[17];
+        snprintf(lHex, sizeof(lHex), "%016llx", (unsigned long long)lSignature);
+        lJson << "  \"signature\": \"" << lHex << "\",\n  \"time_to_depth\": [";
+        for (std::size_t i = 0; i < lTimeTo.size(); ++i)
+            lJson << (i ? ", " : "") << lTimeTo[i] / lReached[i];
+        lJson << "],\n  \"results\": [\n";
+        for (std::size_t p = 0; p < lResults.size(); ++p)
+            lJson << "    { \"depth\": " << (lResults[p].mIterations.empty() ? 0 : lResults[p].mIterations.back().mDepth)
+                  << ", \"nodes\": " << lResults[p].mNodes << ", \"seconds\": " << lResults[p].mSeconds << " }"
+                  << (p + 1 < lResults.size() ? "," : "") << "\n";
+        lJson << "  ]\n}\n";
+
+        if (lOptions.mJson == "-")
+            std::cout << lJson.str();
+        else
+        {
+            std::ofstream lFile(lOptions.mJson.c_str());
+            if (!(lFile << lJson.str()))
+            {
+                std::cerr << "Cannot write '" << lOptions.mJson << "'" << std::endl;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Plays one game on the server of tools/server.cpp for a referee.
+//
+// Takes the place of TTT: it is started with the same parameters and
+// talks over standard input and output in the same way, but passes every
+// message on to the server, which does the searching.
+//
+// Usage: client [socket=PATH] [init] [fast] [check] [name=value ...]
+//   socket=PATH    the socket of the server (default /tmp/ttt3d.sock)
+// The other parameters are those of TTT and are sent to the server.
+// Linux only.
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+///writes all of \p pSize bytes, returns false if the other end is gone
+bool writeAll(int pFd, const char *pData, std::size_t pSize)
+{
+    while (pSize > 0)
+    {
+        ssize_t lWritten = write(pFd, pData, pSize);
+        if (lWritten < 0 && errno == EINTR)
+            continue;
+        if (lWritten <= 0)
+            return false;
+        pData += lWritten;
+        pSize -= lWritten;
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    std::string lSocket = "/tmp/ttt3d.sock";
+    std::string lStart = "new";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        if (lArg.compare(0, 7, "socket=") == 0)
+            lSocket = lArg.substr(7);
+        else
+            lStart += " " + lArg;
+    }
+    lStart += "\n";
+
+    struct sockaddr_un lAddress;
+    memset(&lAddress, 0, sizeof(lAddress));
+    lAddress.sun_family = AF_UNIX;
+    if (lSocket.size() >= sizeof(lAddress.sun_path))
+    {
+        std::cerr << "Socket path too long: '" << lSocket << "'" << std::endl;
+        return -1;
+    }
+    strcpy(lAddress.sun_path, lSocket.c_str());
+    int lServer = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lServer < 0 || connect(lServer, (struct sockaddr*)&lAddress, sizeof(lAddress)) < 0)
+    {
+        std::cerr << "Cannot connect to '" << lSocket << "': " << strerror(errno) << std::endl;
+        return -1;
+    }
+    if (!writeAll(lServer, lStart.data(), lStart.size()))
+        return -1;
+
+    // Pass the bytes on both ways until the server ends the game
+    struct pollfd lFds[2] = { { 0, POLLIN, 0 }, { lServer, POLLIN, 0 } };
+    char lBuffer[4096];
+    for (;;)
+    {
+        if (poll(lFds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (lFds[1].revents)
+        {
+            ssize_t lRead = read(lServer, lBuffer, sizeof(lBuffer));
+            if (lRead <= 0)
+                return 0;
+            if (!writeAll(1, lBuffer, lRead))
+                return -1;
+        }
+        if (lFds[0].revents)
+        {
+            ssize_t lRead = read(0, lBuffer, sizeof(lBuffer));
+            if (lRead <= 0)
+            {
+                // No more moves will come, but the server may still answer the last one
+                shutdown(lServer, SHUT_WR);
+                lFds[0].fd = -1;
+            }
+            else if (!writeAll(lServer, lBuffer, lRead))
+                return -1;
+        }
+    }
+}
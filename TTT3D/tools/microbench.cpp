@@ -0,0 +1,355 @@
+// Times the board primitives one by one on mid-game positions.
+//
+// The inputs are positions from random games, 16 to 40 plies in. Every
+// benchmark runs over all of them in batches long enough for the clock:
+// one batch warms up, then reps batches are timed and the median, the 10th
+// and 90th percentiles and the minimum time per call are reported, with
+// the median in CPU cycles where the time stamp counter is available.
+//
+// Before timing anything, every LineEvaluator kernel the CPU runs is checked
+// against the scalar one, on the positions and on random pairs of
+// bitboards; the program stops with an error if any score differs. Each of
+// those kernels is then timed as "LineEvaluator/<kernel>".
+//
+// To compare two builds, let the first save its results and the second
+// read them back:
+//   ./microbench_old save=old.txt
+//   ./microbench_new compare=old.txt
+//
+// Usage: microbench [name=value ...]
+//   reps=N         timed batches per benchmark (default 31)
+//   filter=TEXT    only run the benchmarks whose name contains TEXT
+//   save=FILE      write the median times to FILE
+//   compare=FILE   show the change against the median times in FILE
+//   seed=N         random seed for the positions (default 1)
+// Any other name=value is passed on to the engine (see Player::configure).
+
+#include "player.hpp"
+#include "lineeval.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <x86intrin.h>
+#define TTT_HAVE_RDTSC 1
+#endif
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+struct Options
+{
+    int mReps = 31;
+    std::string mFilter;
+    std::string mSave;
+    std::string mCompare;
+    unsigned mSeed = 1;
+    std::vector<std::string> mEngine;
+};
+
+// Number of positions the benchmarks run over
+const int cInputs = 256;
+
+// Shortest batch worth timing, in seconds
+const double cMinBatch = 0.01;
+
+///keeps the compiler from optimising away a result
+template<class T>
+inline void keep(const T &pValue)
+{
+#ifdef __GNUC__
+    asm volatile("" : : "g"(&pValue) : "memory");
+#else
+    static volatile const void *sSink;
+    sSink = &pValue;
+#endif
+}
+
+inline uint64_t cycles()
+{
+#ifdef TTT_HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+///the positions and what the benchmarks need from them
+struct Inputs
+{
+    std::vector<GameState> mStates;
+    std::vector<std::string> mMessages;
+    std::vector<std::string> mMoves;        ///< getMove().toMessage() of each state
+    std::vector<int> mCells;                ///< an empty cell of each state
+    std::vector<Move> mLegal;               ///< a legal move in each state
+};
+
+void makeInputs(unsigned pSeed, Inputs &pInputs)
+{
+    std::mt19937 lRandom(pSeed);
+    std::vector<GameState> lChildren;
+    while ((int)pInputs.mStates.size() < cInputs)
+    {
+        GameState lState;
+        int lPlies = 16 + lRandom() % 25;
+        bool lOk = true;
+        for (int p = 0; p < lPlies && lOk; ++p)
+        {
+            lState.findPossibleMoves(lChildren);
+            lState = lChildren[lRandom() % lChildren.size()];
+            lOk = !lState.isEOG();
+        }
+        if (!lOk)
+            continue;
+
+        lState.findPossibleMoves(lChildren);
+        const GameState &lChild = lChildren[lRandom() % lChildren.size()];
+        pInputs.mStates.push_back(lState);
+        pInputs.mMessages.push_back(lState.toMessage());
+        pInputs.mMoves.push_back(lState.getMove().toMessage());
+        pInputs.mCells.push_back(lChild.getMove()[0]);
+        pInputs.mLegal.push_back(lChild.getMove());
+    }
+}
+
+struct Timing
+{
+    double mMedian;     ///< nanoseconds per call
+    double mP10;
+    double mP90;
+    double mMin;
+    double mCycles;     ///< median cycles per call
+};
+
+///times \p pCall, which makes one call for input i
+Timing measure(const std::function<void(int)> &pCall, int pReps)
+{
+    // Find how many rounds over the inputs fill a batch
+    int lRounds = 1;
+    for (;;)
+    {
+        std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+        for (int r = 0; r < lRounds; ++r)
+            for (int i = 0; i < cInputs; ++i)
+                pCall(i);
+        double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+        if (lSeconds >= cMinBatch || lRounds >= (1 << 20))
+            break;
+        lRounds *= 2;
+    }
+
+    // The batch above was the warm-up
+    std::vector<double> lTimes(pReps), lCycles(pReps);
+    double lCalls = (double)lRounds * cInputs;
+    for (int k = 0; k < pReps; ++k)
+    {
+        std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+        uint64_t lFirst = cycles();
+        for (int r = 0; r < lRounds; ++r)
+            for (int i = 0; i < cInputs; ++i)
+                pCall(i);
+        uint64_t lLast = cycles();
+        lTimes[k] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - lStart).count() / lCalls;
+        lCycles[k] = (lLast - lFirst) / lCalls;
+    }
+    std::sort(lTimes.begin(), lTimes.end());
+    std::sort(lCycles.begin(), lCycles.end());
+
+    Timing lTiming;
+    lTiming.mMedian = lTimes[pReps / 2];
+    lTiming.mP10 = lTimes[pReps / 10];
+    lTiming.mP90 = lTimes[pReps - 1 - pReps / 10];
+    lTiming.mMin = lTimes[0];
+    lTiming.mCycles = lCycles[pReps / 2];
+    return lTiming;
+}
+
+///returns false, after saying where, if a kernel scores anything unlike the scalar kernel
+bool checkKernels(const Inputs &pInputs, unsigned pSeed)
+{
+    // Bitboards that are not positions reach the counts of 4 that a game ends on
+    std::mt19937_64 lRandom(pSeed);
+    std::vector<uint64_t> lX(cInputs), lO(cInputs);
+    for (int i = 0; i < cInputs; ++i)
+    {
+        uint64_t lMask = lRandom();
+        lX[i] = lRandom() & lMask;
+        lO[i] = lRandom() & ~lMask;
+    }
+
+    LineEvaluator lScalar(LineEvaluator::KERNEL_SCALAR);
+    std::vector<int> lStateScores(cInputs), lBoardScores(cInputs);
+    for (int i = 0; i < cInputs; ++i)
+    {
+        lStateScores[i] = lScalar.evaluate(pInputs.mStates[i]);
+        lBoardScores[i] = lScalar.evaluate(lX[i], lO[i]);
+    }
+    for (int i = 0; i < cInputs; ++i)
+        if (lStateScores[i] != pInputs.mStates[i].getScore())
+        {
+            std::cerr << "The running score of " << pInputs.mMessages[i] << " is " << pInputs.mStates[i].getScore()
+                      << ", the lines give " << lStateScores[i] << std::endl;
+            return false;
+        }
+
+    for (int k = LineEvaluator::KERNEL_SCALAR + 1; k <= LineEvaluator::KERNEL_AVX512; ++k)
+    {
+        LineEvaluator::Kernel lKernel = LineEvaluator::Kernel(k);
+        if (!LineEvaluator::isSupported(lKernel))
+            continue;
+        LineEvaluator lEvaluator(lKernel);
+        for (int i = 0; i < cInputs; ++i)
+        {
+            int lScore = lEvaluator.evaluate(pInputs.mStates[i]);
+            if (lScore != lStateScores[i])
+            {
+                std::cerr << "Kernel " << LineEvaluator::kernelName(lKernel) << " scores " << pInputs.mMessages[i]
+                          << " as " << lScore << ", the scalar kernel as " << lStateScores[i] << std::endl;
+                return false;
+            }
+            lScore = lEvaluator.evaluate(lX[i], lO[i]);
+            if (lScore != lBoardScores[i])
+            {
+                std::cerr << "Kernel " << LineEvaluator::kernelName(lKernel) << " scores X " << lX[i] << " O " << lO[i]
+                          << " as " << lScore << ", the scalar kernel as " << lBoardScores[i] << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "reps")
+            pOptions.mReps = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "filter")
+            pOptions.mFilter = lValue;
+        else if (lName == "save")
+            pOptions.mSave = lValue;
+        else if (lName == "compare")
+            pOptions.mCompare = lValue;
+        else if (lName == "seed")
+            pOptions.mSeed = (unsigned)atol(lValue.c_str());
+        else if (lEqual != std::string::npos)
+            pOptions.mEngine.push_back(lArg);
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    Player lPlayer;
+    for (std::size_t i = 0; i < lOptions.mEngine.size(); ++i)
+        if (!lPlayer.configure(lOptions.mEngine[i]))
+        {
+            std::cerr << "Invalid option: '" << lOptions.mEngine[i] << "'" << std::endl;
+            return -1;
+        }
+
+    std::map<std::string, double> lBaseline;
+    if (!lOptions.mCompare.empty())
+    {
+        std::ifstream lFile(lOptions.mCompare.c_str());
+        std::string lName;
+        double lTime;
+        while (lFile >> lName >> lTime)
+            lBaseline[lName] = lTime;
+        if (lBaseline.empty())
+        {
+            std::cerr << "No results in '" << lOptions.mCompare << "'" << std::endl;
+            return -1;
+        }
+    }
+
+    Inputs lInputs;
+    makeInputs(lOptions.mSeed, lInputs);
+    if (!checkKernels(lInputs, lOptions.mSeed))
+        return -1;
+    std::vector<GameState> lChildren;
+    std::vector<GameState> lOthers(lInputs.mStates.begin() + 1, lInputs.mStates.end());
+    lOthers.push_back(lInputs.mStates[0]);
+
+    // Special_Move is private, moveTo is the public call that runs it
+    std::vector<std::pair<std::string, std::function<void(int)> > > lBenchmarks = {
+        { "findPossibleMoves", [&](int i) { lInputs.mStates[i].findPossibleMoves(lChildren); keep(lChildren); } },
+        { "moveTo", [&](int i) { Move lMove = lInputs.mStates[i].moveTo(lInputs.mCells[i]); keep(lMove); } },
+        { "copy", [&](int i) { GameState lCopy(lInputs.mStates[i]); keep(lCopy); } },
+        { "copy+doMove", [&](int i) { GameState lCopy(lInputs.mStates[i]); lCopy.doMove(lInputs.mLegal[i]); keep(lCopy); } },
+        { "GameState(string)", [&](int i) { GameState lState(lInputs.mMessages[i]); keep(lState); } },
+        { "toMessage", [&](int i) { std::string lMessage = lInputs.mStates[i].toMessage(); keep(lMessage); } },
+        { "Move(string)", [&](int i) { Move lMove(lInputs.mMoves[i]); keep(lMove); } },
+        { "isEqual", [&](int i) { bool lEqual = lInputs.mStates[i].isEqual(lOthers[i]); keep(lEqual); } },
+        { "evaluation", [&](int i) { double lValue = lPlayer.evaluation(lInputs.mStates[i]); keep(lValue); } },
+    };
+    std::vector<LineEvaluator> lEvaluators;
+    for (int k = LineEvaluator::KERNEL_SCALAR; k <= LineEvaluator::KERNEL_AVX512; ++k)
+        if (LineEvaluator::isSupported(LineEvaluator::Kernel(k)))
+            lEvaluators.push_back(LineEvaluator(LineEvaluator::Kernel(k)));
+    for (std::size_t k = 0; k < lEvaluators.size(); ++k)
+    {
+        const LineEvaluator &lEvaluator = lEvaluators[k];
+        lBenchmarks.push_back({ std::string("LineEvaluator/") + LineEvaluator::kernelName(lEvaluator.getKernel()),
+                                [&, k](int i) { int lScore = lEvaluators[k].evaluate(lInputs.mStates[i]); keep(lScore); } });
+    }
+
+    std::ofstream lSave;
+    if (!lOptions.mSave.empty())
+    {
+        lSave.open(lOptions.mSave.c_str());
+        if (!lSave)
+        {
+            std::cerr << "Cannot write '" << lOptions.mSave << "'" << std::endl;
+            return -1;
+        }
+    }
+
+    printf("%-20s %10s %10s %10s %10s %10s", "primitive", "median ns", "p10 ns", "p90 ns", "min ns", "cycles");
+    if (!lBaseline.empty())
+        printf(" %10s %8s", "baseline", "change");
+    printf("\n");
+    for (std::size_t b = 0; b < lBenchmarks.size(); ++b)
+    {
+        const std::string &lName = lBenchmarks[b].first;
+        if (lName.find(lOptions.mFilter) == std::string::npos)
+            continue;
+        Timing lTiming = measure(lBenchmarks[b].second, lOptions.mReps);
+        printf("%-20s %10.1f %10.1f %10.1f %10.1f %10.0f", lName.c_str(), lTiming.mMedian, lTiming.mP10,
+               lTiming.mP90, lTiming.mMin, lTiming.mCycles);
+        std::map<std::string, double>::const_iterator lOld = lBaseline.find(lName);
+        if (lOld != lBaseline.end())
+            printf(" %10.1f %+7.1f%%", lOld->second, 100 * (lTiming.mMedian / lOld->second - 1));
+        printf("\n");
+        if (lSave.is_open())
+            lSave << lName << ' ' << lTiming.mMedian << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Trains the n-tuple network of ntuple.hpp by temporal-difference learning
+// from self-play.
+//
+// Games are played in batches. Within a batch every thread plays its share
+// of the games with the current weights (read only), then the TD(0) updates
+// of all the games are applied in game order. Each game has its own random
+// seed, so the result does not depend on the number of threads.
+//
+// Usage: ntuple_train [name=value ...]
+//   out=FILE       where to write the network (default ntuple.bin)
+//   in=FILE        network to start from (default: all weights 0)
+//   games=N        number of self-play games (default 100000)
+//   batch=N        games per batch (default 256)
+//   threads=N      worker threads (default: all cores)
+//   alpha=X        learning rate (default 0.01)
+//   epsilon=X      probability of a random move (default 0.1)
+//   seed=N         random seed (default 1)
+
+#include "ntuple.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+struct Options
+{
+    std::string mOut = "ntuple.bin";
+    std::string mIn;
+    long mGames = 100000;
+    int mBatch = 256;
+    int mThreads = std::max(1u, std::thread::hardware_concurrency());
+    float mAlpha = 0.01f;
+    double mEpsilon = 0.1;
+    unsigned mSeed = 1;
+};
+
+///positions after each move of one game, and its result seen from X
+struct Game
+{
+    std::vector<uint64_t> mX;
+    std::vector<uint64_t> mO;
+    float mResult;
+};
+
+///plays one game, each side picking the child with the best value for it
+void selfPlay(const NTupleNet &pNet, const Options &pOptions, unsigned pSeed, Game &pGame)
+{
+    std::mt19937 lRandom(pSeed);
+    std::uniform_real_distribution<double> lCoin(0, 1);
+
+    pGame.mX.clear();
+    pGame.mO.clear();
+
+    GameState lState;
+    std::vector<GameState> lChildren;
+    for (;;)
+    {
+        lState.findPossibleMoves(lChildren);
+        if (lChildren.empty())
+            break;
+
+        std::size_t lPick = 0;
+        if (lCoin(lRandom) < pOptions.mEpsilon)
+            lPick = lRandom() % lChildren.size();
+        else
+        {
+            float lSign = (lState.getNextPlayer() == CELL_X) ? 1.0f : -1.0f;
+            float lBest = -INFINITY;
+            for (std::size_t i = 0; i < lChildren.size(); ++i)
+            {
+                const GameState &lChild = lChildren[i];
+                float lValue = lChild.isEOG() ? (lChild.isDraw() ? 0.0f : 2.0f)
+                                              : lSign * std::tanh(pNet.evaluate(lChild));
+                if (lValue > lBest)
+                {
+                    lBest = lValue;
+                    lPick = i;
+                }
+            }
+        }
+
+        lState = lChildren[lPick];
+        pGame.mX.push_back(lState.getPieces(CELL_X));
+        pGame.mO.push_back(lState.getPieces(CELL_O));
+    }
+
+    pGame.mResult = lState.isXWin() ? 1.0f : (lState.isOWin() ? -1.0f : 0.0f);
+}
+
+///moves the value of every non-final position of \p pGame towards the value of the next one
+void learn(NTupleNet &pNet, const Options &pOptions, const Game &pGame)
+{
+    float *lWeights = pNet.mutableWeights();
+    std::size_t lLast = pGame.mX.size() - 1;
+    for (std::size_t t = 0; t < lLast; ++t)
+    {
+        float lValue = std::tanh(pNet.evaluate(pGame.mX[t], pGame.mO[t]));
+        float lTarget = (t + 1 == lLast) ? pGame.mResult : std::tanh(pNet.evaluate(pGame.mX[t + 1], pGame.mO[t + 1]));
+        float lStep = pOptions.mAlpha * (lTarget - lValue) * (1 - lValue * lValue);
+        for (int k = 0; k < Tuples::cCount; ++k)
+            lWeights[k * Tuples::cEntries + NTupleNet::index(pGame.mX[t], pGame.mO[t], k)] += lStep;
+    }
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "out")
+            pOptions.mOut = lValue;
+        else if (lName == "in")
+            pOptions.mIn = lValue;
+        else if (lName == "games")
+            pOptions.mGames = atol(lValue.c_str());
+        else if (lName == "batch")
+            pOptions.mBatch = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "threads")
+            pOptions.mThreads = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "alpha")
+            pOptions.mAlpha = (float)atof(lValue.c_str());
+        else if (lName == "epsilon")
+            pOptions.mEpsilon = atof(lValue.c_str());
+        else if (lName == "seed")
+            pOptions.mSeed = (unsigned)atol(lValue.c_str());
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    NTupleNet lNet;
+    if (!lOptions.mIn.empty() && !lNet.load(lOptions.mIn))
+        return -1;
+    lNet.mutableWeights();
+
+    std::vector<Game> lBatch(lOptions.mBatch);
+    std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+    long lPlayed = 0;
+    while (lPlayed < lOptions.mGames)
+    {
+        int lCount = (int)std::min<long>(lOptions.mBatch, lOptions.mGames - lPlayed);
+
+        std::vector<std::thread> lWorkers;
+        for (int w = 0; w < lOptions.mThreads; ++w)
+            lWorkers.push_back(std::thread([&, w]()
+            {
+                for (int g = w; g < lCount; g += lOptions.mThreads)
+                    selfPlay(lNet, lOptions, lOptions.mSeed + (unsigned)(lPlayed + g) * 2654435761u, lBatch[g]);
+            }));
+        for (std::size_t w = 0; w < lWorkers.size(); ++w)
+            lWorkers[w].join();
+
+        int lWins[3] = { 0, 0, 0 };
+        for (int g = 0; g < lCount; ++g)
+        {
+            learn(lNet, lOptions, lBatch[g]);
+            ++lWins[lBatch[g].mResult > 0 ? 0 : (lBatch[g].mResult < 0 ? 1 : 2)];
+        }
+        lPlayed += lCount;
+
+        double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+        std::cerr << "games " << lPlayed << "  X " << lWins[0] << "  O " << lWins[1] << "  draw " << lWins[2]
+                  << "  (" << (long)(lPlayed / std::max(lSeconds, 1e-9)) << " games/s)" << std::endl;
+    }
+
+    if (!lNet.save(lOptions.mOut))
+    {
+        std::cerr << "Cannot write '" << lOptions.mOut << "'" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Counts the positions reachable in 1 to N moves (perft) and reports the
+// speed of move generation.
+//
+// Usage: perft [name=value ...]
+//   depth=N        deepest count (default 4)
+//   position=MSG   start from this toMessage() string (default: empty board)
+//   threads=N      threads sharing the root moves (default: all cores)
+//   check=1        also count with findPossibleMoves and compare (slow)
+
+#include "perft.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+struct Options
+{
+    int mDepth = 4;
+    std::string mPosition;
+    int mThreads = std::max(1u, std::thread::hardware_concurrency());
+    bool mCheck = false;
+};
+
+///counts with \p pMode and prints the count and the speed, returns the count
+uint64_t run(const GameState &pState, int pDepth, PerftMode pMode, int pThreads)
+{
+    std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+    uint64_t lNodes = perft(pState, pDepth, pMode, pThreads);
+    double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+    std::cout << "depth " << pDepth << (pMode == PERFT_FAST ? "  fast    " : "  legacy  ") << lNodes << " nodes  "
+              << lSeconds << " s  " << (uint64_t)(lNodes / std::max(lSeconds, 1e-9)) << " nodes/s" << std::endl;
+    return lNodes;
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "depth")
+            pOptions.mDepth = atoi(lValue.c_str());
+        else if (lName == "position")
+            pOptions.mPosition = lValue;
+        else if (lName == "threads")
+            pOptions.mThreads = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "check")
+            pOptions.mCheck = atoi(lValue.c_str()) != 0;
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    GameState lState;
+    if (!lOptions.mPosition.empty())
+        lState = GameState(lOptions.mPosition);
+
+    bool lOk = true;
+    for (int d = 1; d <= lOptions.mDepth; ++d)
+    {
+        uint64_t lNodes = run(lState, d, PERFT_FAST, lOptions.mThreads);
+        if (lOptions.mCheck && run(lState, d, PERFT_LEGACY, lOptions.mThreads) != lNodes)
+        {
+            std::cout << "*** MISMATCH at depth " << d << " ***" << std::endl;
+            lOk = false;
+        }
+    }
+    return lOk ? 0 : 1;
+}
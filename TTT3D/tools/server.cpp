@@ -0,0 +1,529 @@
+// Serves many games at once over a Unix domain socket.
+//
+// Each connection is one game. The client starts it with the line
+//     new [init] [fast] [check] [name=value ...]
+// (the parameters of TTT, engine options included) and the game then goes
+// on as over standard input and output: every state received is answered
+// with our move on the same connection, and with init the server sends the
+// starting board first. The server closes the connection when the game is
+// over, or at the first line that is not a board. tools/client.cpp connects
+// a referee to the server.
+//
+// One thread watches all the connections with epoll; the searches are
+// coroutines run by the Scheduler of scheduler.hpp on a few threads. A
+// search yields every slice= nodes, wherever it is in the tree (see
+// Player::advance), and then waits behind the moves due before it, so
+// that with more games than cores every move still gets its share. The
+// engine options given to the server are loaded once and shared by all the
+// games (pattern weights, n-tuple networks, and the Zobrist keys), while
+// each game searches with its own transposition table of hash= megabytes.
+// A move is due a fixed wall-clock time after it was received.
+//
+// Usage: server [name=value ...]
+//   socket=PATH    the socket to listen on (default /tmp/ttt3d.sock)
+//   threads=N      searching threads (default: all cores)
+//   hash=MB        transposition table of each game (default 4)
+//   slice=NODES    nodes searched between two yields (default 256, 0: whole moves)
+// Any other name=value is passed on to the engine of every game (see
+// Player::configure). Linux only, needs -std=c++20.
+
+#include "player.hpp"
+#include "log.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+struct Options
+{
+    std::string mSocket = "/tmp/ttt3d.sock";
+    int mThreads = std::max(1u, std::thread::hardware_concurrency());
+    int mHash = 4;
+    uint64_t mSlice = 256;
+    std::vector<std::string> mEngine;
+};
+
+// Longest line accepted from a client
+const std::size_t cMaxLine = 4096;
+
+struct Session
+{
+    int mFd;
+    long mId;
+    Player mPlayer;             ///< only touched by the search while mBusy
+    bool mStarted = false;      ///< got the "new" line
+    bool mFast = false;
+    bool mCheck = false;
+    bool mBusy = false;         ///< our move is being searched
+    bool mDone = false;         ///< close once mOut is written
+    bool mEof = false;          ///< the client sends no more, close once its moves are answered
+    bool mClosed = false;
+    std::string mIn;
+    std::string mOut;
+    std::deque<std::pair<std::string, Deadline> > mPending;    ///< moves received, and when they are due
+};
+
+typedef std::shared_ptr<Session> SessionPtr;
+
+struct Result
+{
+    SessionPtr mSession;
+    std::string mReply;         ///< empty if there is nothing to send
+    bool mOver;                 ///< the game is over, or went wrong
+};
+
+///the searches finished, waiting for the event loop
+struct Results
+{
+    std::mutex mMutex;
+    std::vector<Result> mResults;
+    int mEvent = -1;            ///< eventfd that tells the loop of new results
+
+    void post(const Result &pResult)
+    {
+        {
+            std::lock_guard<std::mutex> lLock(mMutex);
+            mResults.push_back(pResult);
+        }
+        uint64_t lOne = 1;
+        if (write(mEvent, &lOne, sizeof(lOne)) < 0)
+            TTT_LOG(LOG_ERROR, "cannot wake the event loop: {}", strerror(errno));
+    }
+};
+
+volatile std::sig_atomic_t sQuit = 0;
+
+void onSignal(int)
+{
+    sQuit = 1;
+}
+
+///searches our answer to \p pMessage, in slices of \p pSlice nodes
+Task search(Scheduler &pScheduler, Results &pResults, SessionPtr pSession,
+            std::string pMessage, Deadline pDue, uint64_t pSlice)
+{
+    Session &lSession = *pSession;
+    Result lResult = { pSession, std::string(), true };
+
+    GameState lInput(pMessage);
+    if (lInput.toMessage() != pMessage)
+        TTT_LOG(LOG_ERROR, "game {}: cannot read '{}'", lSession.mId, pMessage);
+    else if (!lInput.getMove().isEOG())
+    {
+        if (lSession.mPlayer.begin(lInput, pDue))
+            while (!lSession.mPlayer.advance(pSlice))
+                co_await pScheduler.yield();
+        GameState lOutput = lSession.mPlayer.result();
+        if (lSession.mCheck && !lInput.isLegalSuccessor(lOutput))
+            TTT_LOG(LOG_ERROR, "game {}: illegal move '{}'", lSession.mId, lOutput.toMessage());
+        else
+        {
+            lResult.mReply = lOutput.toMessage();
+            lResult.mReply += '\n';
+            lResult.mOver = lOutput.getMove().isEOG();
+        }
+    }
+    pResults.post(lResult);
+}
+
+class Server
+{
+public:
+    Server(const Options &pOptions, const Player &pPrototype)
+        :   mOptions(pOptions),
+            mPrototype(pPrototype),
+            mEpoll(-1),
+            mListen(-1),
+            mGames(0)
+    {
+    }
+
+    bool open();
+    void run();
+    void close();
+
+private:
+    void accept();
+    void read(const SessionPtr &pSession);
+    void flush(const SessionPtr &pSession);
+    void finish(const SessionPtr &pSession);
+    bool start(Session &pSession, const std::string &pLine);
+    void dispatch(const SessionPtr &pSession);
+    void collect();
+    void watch(int pFd, uint32_t pEvents, int pOperation);
+
+    const Options &mOptions;
+    const Player &mPrototype;
+    int mEpoll;
+    int mListen;
+    long mGames;
+    Results mResults;
+    std::unique_ptr<Scheduler> mScheduler;
+    std::map<int, SessionPtr> mSessions;
+};
+
+void Server::watch(int pFd, uint32_t pEvents, int pOperation)
+{
+    struct epoll_event lEvent;
+    memset(&lEvent, 0, sizeof(lEvent));
+    lEvent.events = pEvents;
+    lEvent.data.fd = pFd;
+    epoll_ctl(mEpoll, pOperation, pFd, &lEvent);
+}
+
+bool Server::open()
+{
+    struct sockaddr_un lAddress;
+    memset(&lAddress, 0, sizeof(lAddress));
+    lAddress.sun_family = AF_UNIX;
+    if (mOptions.mSocket.size() >= sizeof(lAddress.sun_path))
+    {
+        std::cerr << "Socket path too long: '" << mOptions.mSocket << "'" << std::endl;
+        return false;
+    }
+    strcpy(lAddress.sun_path, mOptions.mSocket.c_str());
+
+    mListen = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(mOptions.mSocket.c_str());
+    if (mListen < 0 || bind(mListen, (struct sockaddr*)&lAddress, sizeof(lAddress)) < 0 || listen(mListen, 128) < 0)
+    {
+        std::cerr << "Cannot listen on '" << mOptions.mSocket << "': " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    mEpoll = epoll_create1(EPOLL_CLOEXEC);
+    mResults.mEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mEpoll < 0 || mResults.mEvent < 0)
+    {
+        std::cerr << "Cannot set up the event loop: " << strerror(errno) << std::endl;
+        return false;
+    }
+    watch(mListen, EPOLLIN, EPOLL_CTL_ADD);
+    watch(mResults.mEvent, EPOLLIN, EPOLL_CTL_ADD);
+
+    mScheduler.reset(new Scheduler(mOptions.mThreads));
+    return true;
+}
+
+void Server::run()
+{
+    Trace::nameThread("event loop");
+    std::vector<struct epoll_event> lEvents(64);
+    while (!sQuit)
+    {
+        int lCount = epoll_wait(mEpoll, &lEvents[0], (int)lEvents.size(), -1);
+        if (lCount < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            TTT_LOG(LOG_ERROR, "epoll_wait: {}", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < lCount; ++i)
+        {
+            int lFd = lEvents[i].data.fd;
+            if (lFd == mListen)
+                accept();
+            else if (lFd == mResults.mEvent)
+                collect();
+            else
+            {
+                std::map<int, SessionPtr>::iterator lSession = mSessions.find(lFd);
+                if (lSession == mSessions.end())
+                    continue;
+                SessionPtr lKeep = lSession->second;
+                if (lEvents[i].events & EPOLLOUT)
+                    flush(lKeep);
+                if (!lKeep->mClosed && (lEvents[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                    read(lKeep);
+            }
+        }
+    }
+}
+
+void Server::close()
+{
+    // The searches left are dropped before the results they would post to
+    if (mScheduler)
+        mScheduler->stop();
+    while (!mSessions.empty())
+        finish(mSessions.begin()->second);
+    if (mListen >= 0)
+    {
+        ::close(mListen);
+        unlink(mOptions.mSocket.c_str());
+    }
+    TTT_LOG(LOG_INFO, "served {} games", mGames);
+}
+
+void Server::accept()
+{
+    for (;;)
+    {
+        int lFd = accept4(mListen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (lFd < 0)
+            return;
+        SessionPtr lSession = std::make_shared<Session>();
+        lSession->mFd = lFd;
+        lSession->mId = ++mGames;
+        mSessions[lFd] = lSession;
+        watch(lFd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+    }
+}
+
+void Server::read(const SessionPtr &pSession)
+{
+    Session &lSession = *pSession;
+    char lBuffer[4096];
+    for (;;)
+    {
+        ssize_t lRead = ::read(lSession.mFd, lBuffer, sizeof(lBuffer));
+        if (lRead > 0)
+        {
+            lSession.mIn.append(lBuffer, lRead);
+            continue;
+        }
+        if (lRead < 0 && errno == EINTR)
+            continue;
+        if (lRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (lRead < 0)
+        {
+            finish(pSession);
+            return;
+        }
+        lSession.mEof = true;
+        break;
+    }
+
+    std::string::size_type lEnd;
+    while ((lEnd = lSession.mIn.find('\n')) != std::string::npos)
+    {
+        std::string lLine = lSession.mIn.substr(0, lEnd);
+        lSession.mIn.erase(0, lEnd + 1);
+        if (!lLine.empty() && lLine.back() == '\r')
+            lLine.pop_back();
+        if (!lSession.mStarted)
+        {
+            if (!start(lSession, lLine))
+            {
+                finish(pSession);
+                return;
+            }
+            continue;
+        }
+        // GameState asserts on what is not a board, keep it to this game
+        if (!GameState::hasMessageShape(lLine))
+        {
+            TTT_LOG(LOG_WARNING, "game {}: not a board '{}'", lSession.mId, lLine);
+            finish(pSession);
+            return;
+        }
+        lSession.mPending.push_back(std::make_pair(lLine, Deadline::wallNow() + (lSession.mFast ? 0.01 : 0.25)));
+    }
+    if (lSession.mIn.size() > cMaxLine)
+    {
+        TTT_LOG(LOG_WARNING, "game {}: line too long", lSession.mId);
+        finish(pSession);
+        return;
+    }
+    dispatch(pSession);
+    flush(pSession);
+}
+
+bool Server::start(Session &pSession, const std::string &pLine)
+{
+    std::istringstream lWords(pLine);
+    std::string lWord;
+    if (!(lWords >> lWord) || lWord != "new")
+    {
+        TTT_LOG(LOG_WARNING, "game {}: expected 'new', got '{}'", pSession.mId, pLine);
+        return false;
+    }
+
+    // The shared resources come with the copy of the prototype
+    pSession.mPlayer = mPrototype;
+    pSession.mPlayer.configure("hash=" + std::to_string(mOptions.mHash));
+    pSession.mPlayer.configure("clock=wall");
+    bool lInit = false;
+    while (lWords >> lWord)
+    {
+        if (lWord == "init" || lWord == "i")
+            lInit = true;
+        else if (lWord == "fast" || lWord == "f")
+            pSession.mFast = true;
+        else if (lWord == "check" || lWord == "c")
+            pSession.mCheck = true;
+        else if (lWord == "verbose" || lWord == "v")
+            ;
+        else if (!pSession.mPlayer.configure(lWord))
+        {
+            TTT_LOG(LOG_WARNING, "game {}: invalid option '{}'", pSession.mId, lWord);
+            return false;
+        }
+    }
+    pSession.mStarted = true;
+    TTT_LOG(LOG_DEBUG, "game {} started, {} open", pSession.mId, mSessions.size());
+    if (lInit)
+        pSession.mOut += GameState().toMessage() + "\n";
+    return true;
+}
+
+void Server::dispatch(const SessionPtr &pSession)
+{
+    Session &lSession = *pSession;
+    if (lSession.mBusy || lSession.mDone || lSession.mPending.empty())
+        return;
+    std::string lMessage = lSession.mPending.front().first;
+    Deadline lDue = lSession.mPending.front().second;
+    lSession.mPending.pop_front();
+    lSession.mBusy = true;
+    uint64_t lSlice = mOptions.mSlice > 0 ? mOptions.mSlice : UINT64_MAX;
+    mScheduler->spawn(search(*mScheduler, mResults, pSession, lMessage, lDue, lSlice), lDue);
+}
+
+void Server::collect()
+{
+    uint64_t lCount;
+    while (::read(mResults.mEvent, &lCount, sizeof(lCount)) > 0)
+        ;
+    std::vector<Result> lResults;
+    {
+        std::lock_guard<std::mutex> lLock(mResults.mMutex);
+        lResults.swap(mResults.mResults);
+    }
+    for (std::size_t r = 0; r < lResults.size(); ++r)
+    {
+        const SessionPtr &lSession = lResults[r].mSession;
+        lSession->mBusy = false;
+        if (lSession->mClosed)
+            continue;
+        lSession->mOut += lResults[r].mReply;
+        if (lResults[r].mOver)
+            lSession->mDone = true;
+        dispatch(lSession);
+        flush(lSession);
+    }
+}
+
+void Server::flush(const SessionPtr &pSession)
+{
+    Session &lSession = *pSession;
+    while (!lSession.mOut.empty())
+    {
+        ssize_t lWritten = ::write(lSession.mFd, lSession.mOut.data(), lSession.mOut.size());
+        if (lWritten > 0)
+        {
+            lSession.mOut.erase(0, lWritten);
+            continue;
+        }
+        if (lWritten < 0 && errno == EINTR)
+            continue;
+        if (lWritten < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            watch(lSession.mFd, (lSession.mEof ? 0 : EPOLLIN | EPOLLRDHUP) | EPOLLOUT, EPOLL_CTL_MOD);
+            return;
+        }
+        finish(pSession);
+        return;
+    }
+    if (!lSession.mBusy && (lSession.mDone || (lSession.mEof && lSession.mPending.empty())))
+        finish(pSession);
+    else
+        watch(lSession.mFd, lSession.mEof ? 0 : EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+}
+
+void Server::finish(const SessionPtr &pSession)
+{
+    Session &lSession = *pSession;
+    if (lSession.mClosed)
+        return;
+    // A search still running for it only drops its result
+    lSession.mClosed = true;
+    epoll_ctl(mEpoll, EPOLL_CTL_DEL, lSession.mFd, nullptr);
+    ::close(lSession.mFd);
+    mSessions.erase(lSession.mFd);
+    TTT_LOG(LOG_DEBUG, "game {} closed, {} open", lSession.mId, mSessions.size());
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "socket")
+            pOptions.mSocket = lValue;
+        else if (lName == "threads")
+            pOptions.mThreads = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "hash")
+            pOptions.mHash = std::max(0, atoi(lValue.c_str()));
+        else if (lName == "slice")
+            pOptions.mSlice = strtoull(lValue.c_str(), nullptr, 10);
+        else if (lEqual != std::string::npos)
+            pOptions.mEngine.push_back(lArg);
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    // Loaded once, every game starts from a copy; a summary per move would flood the log
+    Player lPrototype;
+    lOptions.mEngine.insert(lOptions.mEngine.begin(), "stats=off");
+    for (std::size_t i = 0; i < lOptions.mEngine.size(); ++i)
+        if (!lPrototype.configure(lOptions.mEngine[i]))
+        {
+            std::cerr << "Invalid option: '" << lOptions.mEngine[i] << "'" << std::endl;
+            return -1;
+        }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    Log::start();
+
+    Server lServer(lOptions, lPrototype);
+    if (!lServer.open())
+        return -1;
+    TTT_LOG(LOG_INFO, "listening on {} with {} threads", lOptions.mSocket, lOptions.mThreads);
+    lServer.run();
+    lServer.close();
+    return 0;
+}
@@ -0,0 +1,345 @@
+// Tunes the pattern weights of patterneval.hpp on a corpus of labelled
+// positions (positions.hpp).
+//
+// The evaluation E of a position is turned into a predicted score for X
+// with sigmoid(K * E), and the weights are fitted with Adam on the
+// logistic loss against the game results. Every epoch the gradient is
+// summed over the whole corpus in chunks of a fixed number of positions:
+// the threads take the chunks in turn, each chunk has its own sums, and
+// the chunks are added in their order. The sums, and so the weights, come
+// out the same bit for bit whatever the number of threads.
+//
+// Usage: tune [name=value ...]
+//   positions=FILE labelled positions to fit (can be repeated)
+//   games=FILE     recorded games (gamerecord.hpp) whose positions to fit (can be repeated)
+//   in=FILE        weights to start from (default: the cHeuristic table)
+//   out=FILE       where to write the tuned weights (default weights.txt)
+//   epochs=N       passes over the corpus (default 200)
+//   rate=X         Adam learning rate, in evaluation units (default 10)
+//   k=X            sigmoid scale (default: fitted to the starting weights)
+//   threads=N      worker threads (default: all cores)
+//
+// To build a corpus from self-play instead:
+//   tune selfplay=N corpus=FILE [epsilon=X] [seed=N]
+// plays N games with the starting weights, picking a random move with
+// probability epsilon (default 0.2), and writes every position reached.
+
+#include "gamerecord.hpp"
+#include "patterneval.hpp"
+#include "positions.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace TICTACTOE3D;
+
+namespace
+{
+
+const int cFeatures = PatternEvaluator::cClasses * PatternEvaluator::cPatterns;
+
+struct Options
+{
+    std::vector<std::string> mPositions;
+    std::vector<std::string> mGames;
+    std::string mIn;
+    std::string mOut = "weights.txt";
+    int mEpochs = 200;
+    double mRate = 10;
+    double mK = 0;
+    int mThreads = std::max(1u, std::thread::hardware_concurrency());
+    long mSelfPlay = 0;
+    std::string mCorpus;
+    double mEpsilon = 0.2;
+    unsigned mSeed = 1;
+};
+
+///the corpus with the feature (class * 81 + pattern) of every line of every position
+struct Corpus
+{
+    std::vector<uint16_t> mFeatures;        ///< Lines::cCount features per position
+    std::vector<double> mTarget;            ///< result mapped to [0, 1]
+};
+
+void buildCorpus(const std::vector<LabelledPosition> &pPositions, int pThreads, Corpus &pCorpus)
+{
+    std::size_t lCount = pPositions.size();
+    pCorpus.mFeatures.resize(lCount * Lines::cCount);
+    pCorpus.mTarget.resize(lCount);
+
+    std::vector<std::thread> lWorkers;
+    for (int w = 0; w < pThreads; ++w)
+        lWorkers.push_back(std::thread([&, w]()
+        {
+            for (std::size_t i = w; i < lCount; i += pThreads)
+            {
+                const LabelledPosition &lPosition = pPositions[i];
+                for (int l = 0; l < Lines::cCount; ++l)
+                    pCorpus.mFeatures[i * Lines::cCount + l] = PatternEvaluator::lineClass(l) * PatternEvaluator::cPatterns +
+                                                               PatternEvaluator::pattern(lPosition.mX, lPosition.mO, l);
+                pCorpus.mTarget[i] = (lPosition.mResult + 1) * 0.5;
+            }
+        }));
+    for (std::size_t w = 0; w < lWorkers.size(); ++w)
+        lWorkers[w].join();
+}
+
+// Positions summed together before the sums of the chunks are added up
+const std::size_t cChunk = 4096;
+
+///returns the mean logistic loss, and adds its gradient to \p pGradient if given
+double loss(const Corpus &pCorpus, const double *pWeights, double pK, int pThreads, double *pGradient)
+{
+    std::size_t lCount = pCorpus.mTarget.size();
+    std::size_t lChunks = (lCount + cChunk - 1) / cChunk;
+    std::vector<double> lLoss(lChunks, 0);
+    std::vector<double> lGradients(pGradient ? lChunks * cFeatures : 0, 0);
+    std::atomic<std::size_t> lNext(0);
+
+    std::vector<std::thread> lWorkers;
+    for (int w = 0; w < pThreads; ++w)
+        lWorkers.push_back(std::thread([&]()
+        {
+            for (std::size_t c = lNext++; c < lChunks; c = lNext++)
+            {
+                std::size_t lBegin = c * cChunk;
+                std::size_t lEnd = std::min(lBegin + cChunk, lCount);
+                double *lGradient = pGradient ? &lGradients[c * cFeatures] : nullptr;
+                double lSum = 0;
+                for (std::size_t i = lBegin; i < lEnd; ++i)
+                {
+                    const uint16_t *lFeatures = &pCorpus.mFeatures[i * Lines::cCount];
+                    double lEval = 0;
+                    for (int l = 0; l < Lines::cCount; ++l)
+                        lEval += pWeights[lFeatures[l]];
+
+                    double lP = 1 / (1 + std::exp(-pK * lEval));
+                    double lY = pCorpus.mTarget[i];
+                    lP = std::min(std::max(lP, 1e-12), 1 - 1e-12);
+                    lSum -= lY * std::log(lP) + (1 - lY) * std::log(1 - lP);
+
+                    if (pGradient)
+                    {
+                        double lD = pK * (lP - lY);
+                        for (int l = 0; l < Lines::cCount; ++l)
+                            lGradient[lFeatures[l]] += lD;
+                    }
+                }
+                lLoss[c] = lSum;
+            }
+        }));
+    for (std::size_t w = 0; w < lWorkers.size(); ++w)
+        lWorkers[w].join();
+
+    double lTotal = 0;
+    for (std::size_t c = 0; c < lChunks; ++c)
+    {
+        lTotal += lLoss[c];
+        if (pGradient)
+            for (int f = 0; f < cFeatures; ++f)
+                pGradient[f] += lGradients[c * cFeatures + f] / lCount;
+    }
+    return lTotal / std::max<std::size_t>(lCount, 1);
+}
+
+///labels every position of the finished games of \p pFile with their result
+bool readGames(const std::string &pFile, std::vector<LabelledPosition> &pPositions)
+{
+    GameRecordReader lReader;
+    if (!lReader.open(pFile))
+        return false;
+    RecordedGame lGame;
+    while (lReader.next(lGame))
+    {
+        if (lGame.mResult == GameRecord::RESULT_NONE)
+            continue;
+        int8_t lResult = (lGame.mResult == GameRecord::RESULT_X) ? 1 : (lGame.mResult == GameRecord::RESULT_O ? -1 : 0);
+        GameReplay lReplay(lGame);
+        while (lReplay.next())
+            if (!lReplay.state().isEOG())
+            {
+                LabelledPosition lPosition = { lReplay.state().getPieces(CELL_X), lReplay.state().getPieces(CELL_O), lResult };
+                pPositions.push_back(lPosition);
+            }
+    }
+    return !lReader.failed();
+}
+
+///plays \p pOptions.mSelfPlay games and labels every position with the result
+void selfPlay(const PatternEvaluator &pEval, const Options &pOptions, std::vector<LabelledPosition> &pPositions)
+{
+    std::mt19937 lRandom(pOptions.mSeed);
+    std::uniform_real_distribution<double> lCoin(0, 1);
+    std::vector<GameState> lChildren;
+    for (long g = 0; g < pOptions.mSelfPlay; ++g)
+    {
+        std::size_t lFirst = pPositions.size();
+        GameState lState;
+        for (;;)
+        {
+            lState.findPossibleMoves(lChildren);
+            if (lChildren.empty())
+                break;
+            std::size_t lPick = lRandom() % lChildren.size();
+            if (lCoin(lRandom) >= pOptions.mEpsilon)
+            {
+                int lSign = (lState.getNextPlayer() == CELL_X) ? 1 : -1;
+                for (std::size_t i = 0; i < lChildren.size(); ++i)
+                    if (lSign * pEval.evaluate(lChildren[i]) > lSign * pEval.evaluate(lChildren[lPick]))
+                        lPick = i;
+            }
+            lState = lChildren[lPick];
+            if (!lState.isEOG())
+            {
+                LabelledPosition lPosition = { lState.getPieces(CELL_X), lState.getPieces(CELL_O), 0 };
+                pPositions.push_back(lPosition);
+            }
+        }
+        int8_t lResult = lState.isXWin() ? 1 : (lState.isOWin() ? -1 : 0);
+        for (std::size_t i = lFirst; i < pPositions.size(); ++i)
+            pPositions[i].mResult = lResult;
+    }
+}
+
+bool parse(int argc, char **argv, Options &pOptions)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string lArg(argv[i]);
+        std::string::size_type lEqual = lArg.find('=');
+        std::string lName = lArg.substr(0, lEqual);
+        std::string lValue = (lEqual == std::string::npos) ? "" : lArg.substr(lEqual + 1);
+        if (lName == "positions")
+            pOptions.mPositions.push_back(lValue);
+        else if (lName == "games")
+            pOptions.mGames.push_back(lValue);
+        else if (lName == "in")
+            pOptions.mIn = lValue;
+        else if (lName == "out")
+            pOptions.mOut = lValue;
+        else if (lName == "epochs")
+            pOptions.mEpochs = atoi(lValue.c_str());
+        else if (lName == "rate")
+            pOptions.mRate = atof(lValue.c_str());
+        else if (lName == "k")
+            pOptions.mK = atof(lValue.c_str());
+        else if (lName == "threads")
+            pOptions.mThreads = std::max(1, atoi(lValue.c_str()));
+        else if (lName == "selfplay")
+            pOptions.mSelfPlay = atol(lValue.c_str());
+        else if (lName == "corpus")
+            pOptions.mCorpus = lValue;
+        else if (lName == "epsilon")
+            pOptions.mEpsilon = atof(lValue.c_str());
+        else if (lName == "seed")
+            pOptions.mSeed = (unsigned)atol(lValue.c_str());
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*namespace*/ }
+
+int main(int argc, char **argv)
+{
+    Options lOptions;
+    if (!parse(argc, argv, lOptions))
+        return -1;
+
+    PatternEvaluator lEval;
+    if (!lOptions.mIn.empty() && !lEval.load(lOptions.mIn))
+        return -1;
+
+    if (lOptions.mSelfPlay > 0)
+    {
+        std::vector<LabelledPosition> lPositions;
+        selfPlay(lEval, lOptions, lPositions);
+        if (lOptions.mCorpus.empty() || !PositionFile::write(lOptions.mCorpus, lPositions))
+        {
+            std::cerr << "Cannot write corpus '" << lOptions.mCorpus << "'" << std::endl;
+            return -1;
+        }
+        std::cerr << "Wrote " << lPositions.size() << " positions to " << lOptions.mCorpus << std::endl;
+        return 0;
+    }
+
+    std::vector<LabelledPosition> lPositions;
+    for (std::size_t i = 0; i < lOptions.mPositions.size(); ++i)
+        if (!PositionFile::read(lOptions.mPositions[i], lPositions))
+            return -1;
+    for (std::size_t i = 0; i < lOptions.mGames.size(); ++i)
+        if (!readGames(lOptions.mGames[i], lPositions))
+            return -1;
+    if (lPositions.empty())
+    {
+        std::cerr << "No positions to tune on, give them with positions=FILE or games=FILE" << std::endl;
+        return -1;
+    }
+
+    std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+    Corpus lCorpus;
+    buildCorpus(lPositions, lOptions.mThreads, lCorpus);
+    std::vector<LabelledPosition>().swap(lPositions);
+
+    std::vector<double> lWeights(cFeatures);
+    for (int f = 0; f < cFeatures; ++f)
+        lWeights[f] = lEval.weight(f / PatternEvaluator::cPatterns, f % PatternEvaluator::cPatterns);
+
+    // Pick the sigmoid scale that best fits the starting weights
+    double lK = lOptions.mK;
+    if (lK <= 0)
+    {
+        double lBest = INFINITY;
+        for (double k = 1e-6; k < 1; k *= 1.25)
+        {
+            double lLoss = loss(lCorpus, &lWeights[0], k, lOptions.mThreads, 0);
+            if (lLoss < lBest)
+            {
+                lBest = lLoss;
+                lK = k;
+            }
+        }
+    }
+    std::cerr << lCorpus.mTarget.size() << " positions, k = " << lK << std::endl;
+
+    // Adam
+    const double cBeta1 = 0.9, cBeta2 = 0.999, cEpsilon = 1e-8;
+    std::vector<double> lM(cFeatures, 0), lV(cFeatures, 0), lGradient(cFeatures);
+    for (int e = 1; e <= lOptions.mEpochs; ++e)
+    {
+        std::fill(lGradient.begin(), lGradient.end(), 0.0);
+        double lLoss = loss(lCorpus, &lWeights[0], lK, lOptions.mThreads, &lGradient[0]);
+        for (int f = 0; f < cFeatures; ++f)
+        {
+            lM[f] = cBeta1 * lM[f] + (1 - cBeta1) * lGradient[f];
+            lV[f] = cBeta2 * lV[f] + (1 - cBeta2) * lGradient[f] * lGradient[f];
+            double lMHat = lM[f] / (1 - std::pow(cBeta1, e));
+            double lVHat = lV[f] / (1 - std::pow(cBeta2, e));
+            lWeights[f] -= lOptions.mRate * lMHat / (std::sqrt(lVHat) + cEpsilon);
+        }
+        if (e == 1 || e % 10 == 0 || e == lOptions.mEpochs)
+        {
+            double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+            std::cerr << "epoch " << e << "  loss " << lLoss << "  (" << lSeconds << " s)" << std::endl;
+        }
+    }
+
+    for (int f = 0; f < cFeatures; ++f)
+        lEval.weight(f / PatternEvaluator::cPatterns, f % PatternEvaluator::cPatterns) = (int)std::lround(lWeights[f]);
+    if (!lEval.save(lOptions.mOut))
+    {
+        std::cerr << "Cannot write '" << lOptions.mOut << "'" << std::endl;
+        return -1;
+    }
+    return 0;
+}
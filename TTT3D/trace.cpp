@@ -0,0 +1,152 @@
+#include "trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+std::atomic<bool> Trace::sEnabled(false);
+
+namespace
+{
+
+struct Span
+{
+    const char *mName;
+    const char *mArg;
+    int64_t mValue;
+    uint64_t mBegin;
+    uint64_t mEnd;
+};
+
+///the spans of one thread
+struct Ring
+{
+    int mThread;
+    std::string mName;
+    Span mSpans[Trace::cCapacity];
+    std::atomic<uint64_t> mHead;    ///< spans ever added
+    std::atomic<uint64_t> mTail;    ///< spans before this one were cleared
+};
+
+// The rings outlive their threads so that write() can still read them
+std::mutex sMutex;
+std::vector<std::unique_ptr<Ring> > sRings;
+thread_local Ring *tRing = nullptr;
+
+const std::chrono::steady_clock::time_point sOrigin = std::chrono::steady_clock::now();
+
+Ring &ring()
+{
+    if (!tRing)
+    {
+        std::unique_ptr<Ring> lRing(new Ring);
+        lRing->mHead = 0;
+        lRing->mTail = 0;
+        std::lock_guard<std::mutex> lLock(sMutex);
+        lRing->mThread = (int)sRings.size() + 1;
+        tRing = lRing.get();
+        sRings.push_back(std::move(lRing));
+    }
+    return *tRing;
+}
+
+void appendString(std::string &pOut, const std::string &pText)
+{
+    pOut += '"';
+    for (std::size_t i = 0; i < pText.size(); ++i)
+    {
+        if (pText[i] == '"' || pText[i] == '\\')
+            pOut += '\\';
+        pOut += pText[i];
+    }
+    pOut += '"';
+}
+
+/*namespace*/ }
+
+void Trace::nameThread(const std::string &pName)
+{
+    Ring &lRing = ring();
+    std::lock_guard<std::mutex> lLock(sMutex);
+    lRing.mName = pName;
+}
+
+uint64_t Trace::clock()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sOrigin).count();
+}
+
+void Trace::add(const char *pName, uint64_t pBegin, uint64_t pEnd, const char *pArg, int64_t pValue)
+{
+    Ring &lRing = ring();
+    uint64_t lHead = lRing.mHead.load(std::memory_order_relaxed);
+    Span &lSpan = lRing.mSpans[lHead % cCapacity];
+    lSpan.mName = pName;
+    lSpan.mArg = pArg;
+    lSpan.mValue = pValue;
+    lSpan.mBegin = pBegin;
+    lSpan.mEnd = pEnd;
+    lRing.mHead.store(lHead + 1, std::memory_order_release);
+}
+
+bool Trace::write(const std::string &pFile)
+{
+    FILE *lFile = fopen(pFile.c_str(), "w");
+    if (!lFile)
+        return false;
+
+    std::string lOut = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool lFirst = true;
+    char lBuffer[256];
+    std::lock_guard<std::mutex> lLock(sMutex);
+    for (std::size_t r = 0; r < sRings.size(); ++r)
+    {
+        const Ring &lRing = *sRings[r];
+        if (!lRing.mName.empty())
+        {
+            snprintf(lBuffer, sizeof(lBuffer), "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":",
+                     lFirst ? "" : ",\n", lRing.mThread);
+            lOut += lBuffer;
+            appendString(lOut, lRing.mName);
+            lOut += "}}";
+            lFirst = false;
+        }
+
+        // Spans are written in the order they ended, the viewer nests them by time
+        uint64_t lHead = lRing.mHead.load(std::memory_order_acquire);
+        uint64_t lFrom = lRing.mTail.load(std::memory_order_relaxed);
+        if (lHead - lFrom > (uint64_t)cCapacity)
+            lFrom = lHead - cCapacity;
+        for (uint64_t i = lFrom; i < lHead; ++i)
+        {
+            const Span &lSpan = lRing.mSpans[i % cCapacity];
+            snprintf(lBuffer, sizeof(lBuffer), "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f",
+                     lFirst ? "" : ",\n", lRing.mThread, lSpan.mName, lSpan.mBegin / 1e3, (lSpan.mEnd - lSpan.mBegin) / 1e3);
+            lOut += lBuffer;
+            if (lSpan.mArg)
+            {
+                snprintf(lBuffer, sizeof(lBuffer), ",\"args\":{\"%s\":%lld}", lSpan.mArg, (long long)lSpan.mValue);
+                lOut += lBuffer;
+            }
+            lOut += "}";
+            lFirst = false;
+        }
+    }
+    lOut += "\n]}\n";
+
+    bool lOk = fwrite(lOut.data(), 1, lOut.size(), lFile) == lOut.size();
+    return (fclose(lFile) == 0) && lOk;
+}
+
+void Trace::clear()
+{
+    std::lock_guard<std::mutex> lLock(sMutex);
+    for (std::size_t r = 0; r < sRings.size(); ++r)
+        sRings[r]->mTail.store(sRings[r]->mHead.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+/*namespace TICTACTOE3D*/ }
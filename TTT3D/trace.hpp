@@ -0,0 +1,94 @@
+#ifndef _TICTACTOE3D_TRACE_HPP_
+#define _TICTACTOE3D_TRACE_HPP_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Timeline of what every thread did, written as Chrome trace events
+ *
+ * Spans are kept in a ring buffer per thread: the thread that owns a
+ * buffer is the only one writing to it, so recording takes no lock and
+ * never waits, and a full buffer drops its oldest spans. Nothing is
+ * recorded until enable() is called.
+ *
+ * write() produces a file that chrome://tracing and ui.perfetto.dev open.
+ * It reads the buffers of all threads, so call it while they are idle,
+ * e.g. between games or after joining them.
+ */
+class Trace
+{
+public:
+    ///spans kept per thread
+    static const int cCapacity = 1 << 14;
+
+    static void enable()    {   sEnabled.store(true, std::memory_order_relaxed);    }
+    static bool enabled()   {   return sEnabled.load(std::memory_order_relaxed);    }
+
+    ///names the calling thread in the timeline
+    static void nameThread(const std::string &pName);
+
+    ///nanoseconds on the clock of the spans
+    static uint64_t clock();
+
+    ///records a span of the calling thread; \p pName and \p pArg must be string literals
+    static void add(const char *pName, uint64_t pBegin, uint64_t pEnd, const char *pArg, int64_t pValue);
+
+    ///writes the spans of all threads to \p pFile, returns false if it cannot be written
+    static bool write(const std::string &pFile);
+
+    ///forgets the spans recorded so far
+    static void clear();
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+/**
+ * Records the time from its construction to its destruction as a span
+ *
+ *     TraceSpan lSpan("iteration", "depth", depth);
+ *
+ * costs a relaxed load when tracing is off.
+ */
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *pName, const char *pArg = nullptr, int64_t pValue = 0)
+        :   mName(pName),
+            mArg(pArg),
+            mValue(pValue),
+            mOn(Trace::enabled()),
+            mBegin(mOn ? Trace::clock() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (mOn)
+            Trace::add(mName, mBegin, Trace::clock(), mArg, mValue);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan &operator=(const TraceSpan&) = delete;
+
+    ///changes the name the span ends with, e.g. when the work was abandoned
+    void rename(const char *pName)  {   mName = pName;  }
+
+    void setValue(int64_t pValue)   {   mValue = pValue;    }
+
+private:
+    const char *mName;
+    const char *mArg;
+    int64_t mValue;
+    bool mOn;
+    uint64_t mBegin;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -0,0 +1,30 @@
+#include "ttable.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+namespace TICTACTOE3D
+{
+
+void TranspositionTable::resize(std::size_t pBytes)
+{
+    TraceSpan lSpan("tt resize", "bytes", pBytes);
+    std::size_t lEntries = 0;
+    if (pBytes >= sizeof(Entry))
+    {
+        lEntries = 1;
+        while (lEntries <= pBytes / (2 * sizeof(Entry)))
+            lEntries *= 2;
+    }
+    std::vector<Entry>(lEntries).swap(mEntries);
+    mMask = lEntries ? lEntries - 1 : 0;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    Entry lEmpty = { 0, 0, 0, BOUND_NONE, cNoMove, 0 };
+    std::fill(mEntries.begin(), mEntries.end(), lEmpty);
+    mAge = 0;
+}
+
+/*namespace TICTACTOE3D*/ }
@@ -0,0 +1,81 @@
+#ifndef _TICTACTOE3D_TTABLE_HPP_
+#define _TICTACTOE3D_TTABLE_HPP_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Transposition table: results of searches, by position key (see zobrist.hpp)
+ *
+ * The table has a fixed number of entries, a power of two, so its memory
+ * stays within what resize() was given however long the game. Each key
+ * has a single slot; a newer or deeper result replaces what is there.
+ */
+class TranspositionTable
+{
+public:
+    enum Bound : uint8_t
+    {
+        BOUND_NONE,
+        BOUND_UPPER,    ///< the value is at most mValue
+        BOUND_LOWER,    ///< the value is at least mValue
+        BOUND_EXACT
+    };
+
+    static const uint8_t cNoMove = 0xff;
+
+    struct Entry
+    {
+        uint64_t mKey;
+        double mValue;
+        int16_t mDepth;     ///< plies searched below the position
+        Bound mBound;
+        uint8_t mBest;      ///< cell of the best move found, or cNoMove
+        uint8_t mAge;       ///< search that stored it
+    };
+
+    ///sets the table to the most entries that fit in \p pBytes (none if it is 0) and clears it
+    void resize(std::size_t pBytes);
+
+    ///forgets every entry
+    void clear();
+
+    ///marks a new search, whose results go before those of the searches before
+    void newSearch()                {   ++mAge;     }
+
+    bool enabled() const            {   return !mEntries.empty();   }
+    std::size_t entries() const     {   return mEntries.size();     }
+
+    ///returns the entry of \p pKey, or null
+    const Entry *probe(uint64_t pKey) const
+    {
+        const Entry &lEntry = mEntries[pKey & mMask];
+        return (lEntry.mKey == pKey && lEntry.mBound != BOUND_NONE) ? &lEntry : nullptr;
+    }
+
+    void store(uint64_t pKey, double pValue, int pDepth, Bound pBound, int pBest)
+    {
+        Entry &lEntry = mEntries[pKey & mMask];
+        if (lEntry.mAge == mAge && lEntry.mKey != pKey && lEntry.mDepth > pDepth)
+            return;
+        lEntry.mKey = pKey;
+        lEntry.mValue = pValue;
+        lEntry.mDepth = (int16_t)pDepth;
+        lEntry.mBound = pBound;
+        lEntry.mBest = (uint8_t)pBest;
+        lEntry.mAge = mAge;
+    }
+
+private:
+    std::vector<Entry> mEntries;
+    uint64_t mMask = 0;
+    uint8_t mAge = 0;
+};
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
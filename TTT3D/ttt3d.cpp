@@ -0,0 +1,254 @@
+#define TTT3D_BUILD
+#include "ttt3d.h"
+#include "engine.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+using namespace TICTACTOE3D;
+
+static_assert(GameState::cMaxMessage < TTT3D_MAX_MESSAGE, "TTT3D_MAX_MESSAGE must hold every message");
+
+// No exception may cross into C: the functions that allocate, or configure and search an
+// engine, turn any into an error
+
+struct ttt3d_engine
+{
+    Engine mEngine;
+    std::vector<Player::Line> mLines;   ///< of the last analysis
+};
+
+struct ttt3d_position
+{
+    GameState mState;
+};
+
+int ttt3d_version(void)
+{
+    return TTT3D_VERSION;
+}
+
+ttt3d_engine *ttt3d_engine_new(void)
+{
+    try
+    {
+        return new ttt3d_engine;
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void ttt3d_engine_free(ttt3d_engine *engine)
+{
+    delete engine;
+}
+
+int ttt3d_engine_configure(ttt3d_engine *engine, const char *option)
+{
+    if (!engine || !option)
+        return -1;
+    try
+    {
+        return engine->mEngine.configure(option) ? 0 : -1;
+    }
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+int ttt3d_engine_play(ttt3d_engine *engine, ttt3d_position *position, double seconds)
+{
+    if (!engine || !position || Engine::legalMoves(position->mState).empty())
+        return -1;
+    try
+    {
+        position->mState = engine->mEngine.play(position->mState, seconds);
+        return position->mState.getMove()[0];
+    }
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+int ttt3d_engine_analyze(ttt3d_engine *engine, const ttt3d_position *position,
+                         const ttt3d_limits *limits, ttt3d_analysis *analysis)
+{
+    if (!engine || !position || !analysis)
+        return -1;
+    try
+    {
+        Engine::Limits lLimits;
+        if (limits)
+        {
+            lLimits.mDepth = limits->depth;
+            lLimits.mSeconds = limits->seconds;
+            lLimits.mNodes = limits->nodes;
+            lLimits.mMultiPV = limits->multipv;
+        }
+        Engine::Analysis lAnalysis = engine->mEngine.analyze(position->mState, lLimits);
+        analysis->cell = lAnalysis.mCell;
+        analysis->score = lAnalysis.mScore;
+        analysis->depth = lAnalysis.mDepth;
+        analysis->nodes = lAnalysis.mNodes;
+        analysis->seconds = lAnalysis.mSeconds;
+        engine->mLines.swap(lAnalysis.mLines);
+        return lAnalysis.mCell < 0 ? -1 : 0;
+    }
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+int ttt3d_engine_line_count(const ttt3d_engine *engine)
+{
+    return engine ? (int)engine->mLines.size() : -1;
+}
+
+int ttt3d_engine_line(const ttt3d_engine *engine, int index, ttt3d_line *line)
+{
+    if (!engine || !line || index < 0 || index >= (int)engine->mLines.size())
+        return -1;
+    const Player::Line &lLine = engine->mLines[index];
+    line->cell = lLine.mCell;
+    line->score = lLine.mScore;
+    line->length = (int)std::min(lLine.mPv.size(), (std::size_t)TTT3D_MAX_PV);
+    for (int i = 0; i < line->length; ++i)
+        line->pv[i] = lLine.mPv[i];
+    return 0;
+}
+
+ttt3d_position *ttt3d_position_new(void)
+{
+    try
+    {
+        return new ttt3d_position;
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+ttt3d_position *ttt3d_position_parse(const char *message)
+{
+    if (!message)
+        return nullptr;
+    try
+    {
+        // Only what reads back to the same message is a position
+        std::string_view lMessage(message);
+        if (!GameState::hasMessageShape(lMessage))
+            return nullptr;
+        GameState lState(lMessage);
+        char lBuffer[GameState::cMaxMessage];
+        if (std::string_view(lBuffer, lState.format(lBuffer) - lBuffer) != lMessage)
+            return nullptr;
+        ttt3d_position *lPosition = new ttt3d_position;
+        lPosition->mState = lState;
+        return lPosition;
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+ttt3d_position *ttt3d_position_copy(const ttt3d_position *position)
+{
+    if (!position)
+        return nullptr;
+    try
+    {
+        return new ttt3d_position(*position);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void ttt3d_position_free(ttt3d_position *position)
+{
+    delete position;
+}
+
+int ttt3d_position_format(const ttt3d_position *position, char *buffer, size_t size)
+{
+    if (!position || !buffer)
+        return -1;
+    char lBuffer[GameState::cMaxMessage];
+    size_t lLength = position->mState.format(lBuffer) - lBuffer;
+    if (lLength >= size)
+        return -1;
+    memcpy(buffer, lBuffer, lLength);
+    buffer[lLength] = '\0';
+    return (int)lLength;
+}
+
+int ttt3d_position_next_player(const ttt3d_position *position)
+{
+    return position ? position->mState.getNextPlayer() : -1;
+}
+
+int ttt3d_position_cell(const ttt3d_position *position, int cell)
+{
+    if (!position || cell < 0 || cell >= GameState::cSquares)
+        return -1;
+    return position->mState.at(cell);
+}
+
+int ttt3d_position_result(const ttt3d_position *position)
+{
+    if (!position)
+        return -1;
+    if (position->mState.isXWin())
+        return 1;
+    if (position->mState.isOWin())
+        return 2;
+    if (position->mState.isEOG())
+        return 3;
+    return 0;
+}
+
+int ttt3d_position_is_over(const ttt3d_position *position)
+{
+    if (!position)
+        return -1;
+    return position->mState.isEOG() ? 1 : 0;
+}
+
+int ttt3d_position_legal_moves(const ttt3d_position *position, int *cells, int capacity)
+{
+    if (!position || (capacity > 0 && !cells))
+        return -1;
+    try
+    {
+        std::vector<int> lCells = Engine::legalMoves(position->mState);
+        for (int i = 0; i < capacity && i < (int)lCells.size(); ++i)
+            cells[i] = lCells[i];
+        return (int)lCells.size();
+    }
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+int ttt3d_position_play(ttt3d_position *position, int cell)
+{
+    if (!position)
+        return -1;
+    try
+    {
+        return Engine::playMove(position->mState, cell) ? 0 : -1;
+    }
+    catch (...)
+    {
+        return -1;
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ * C interface of the engine library (libttt3d), for C programs and for
+ * bindings from other languages. C++ programs can use engine.hpp instead.
+ *
+ *     ttt3d_engine *e = ttt3d_engine_new();
+ *     ttt3d_engine_configure(e, "depth=4");
+ *     ttt3d_position *p = ttt3d_position_new();
+ *     while (!ttt3d_position_is_over(p))
+ *         ttt3d_engine_play(e, p, 0.25);
+ *     ttt3d_position_free(p);
+ *     ttt3d_engine_free(e);
+ *
+ * Positions and engines are opaque and made and freed by the library.
+ * Cells are numbered 0 to 63 as in the messages of TTT; players are 1 (X)
+ * and 2 (O). Functions returning int return -1 on error. Nothing here
+ * throws; an engine is used by one thread at a time.
+ */
+#ifndef TTT3D_H
+#define TTT3D_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(TTT3D_SHARED)
+#ifdef TTT3D_BUILD
+#define TTT3D_API __declspec(dllexport)
+#else
+#define TTT3D_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define TTT3D_API __attribute__((visibility("default")))
+#else
+#define TTT3D_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Changes whenever a declaration below changes in an incompatible way */
+#define TTT3D_VERSION 3
+
+/* Room for the message of any position, terminating zero included */
+#define TTT3D_MAX_MESSAGE 256
+
+/* Longest line of moves reported */
+#define TTT3D_MAX_PV 64
+
+typedef struct ttt3d_engine ttt3d_engine;
+typedef struct ttt3d_position ttt3d_position;
+
+/* What ttt3d_engine_analyze() searches to; 0 leaves a limit out */
+typedef struct ttt3d_limits
+{
+    int depth;                  /* plies, 0 for the depth=N of the engine */
+    double seconds;             /* on the clock of the engine (see clock=) */
+    uint64_t nodes;             /* 0 for the nodes=N of the engine */
+    int multipv;                /* best moves to score exactly, 0 for the multipv=K of the engine */
+} ttt3d_limits;
+
+typedef struct ttt3d_analysis
+{
+    int cell;                   /* best move, -1 if there is no move */
+    double score;               /* for the side to move */
+    int depth;                  /* deepest depth completed */
+    uint64_t nodes;
+    double seconds;
+} ttt3d_analysis;
+
+/* One of the best moves found by ttt3d_engine_analyze(), with the moves expected to follow */
+typedef struct ttt3d_line
+{
+    int cell;
+    double score;               /* exact, for the side to move */
+    int length;                 /* cells in pv, the first being cell */
+    int pv[TTT3D_MAX_PV];
+} ttt3d_line;
+
+/* TTT3D_VERSION of the library linked with */
+TTT3D_API int ttt3d_version(void);
+
+TTT3D_API ttt3d_engine *ttt3d_engine_new(void);
+TTT3D_API void ttt3d_engine_free(ttt3d_engine *engine);
+
+/* Applies an option "name=value" as given to TTT (weights=, depth=, hash=, ...); 0 on success */
+TTT3D_API int ttt3d_engine_configure(ttt3d_engine *engine, const char *option);
+
+/* Plays the move of the engine in position within seconds, returns its cell */
+TTT3D_API int ttt3d_engine_play(ttt3d_engine *engine, ttt3d_position *position, double seconds);
+
+/* Searches position within limits (NULL: the engine's depth, no time limit); 0 on success */
+TTT3D_API int ttt3d_engine_analyze(ttt3d_engine *engine, const ttt3d_position *position,
+                                   const ttt3d_limits *limits, ttt3d_analysis *analysis);
+
+/* The number of best moves the last ttt3d_engine_analyze() scored (multipv), best first */
+TTT3D_API int ttt3d_engine_line_count(const ttt3d_engine *engine);
+
+/* Copies the best move number index (from 0) of the last analysis to line; 0 on success */
+TTT3D_API int ttt3d_engine_line(const ttt3d_engine *engine, int index, ttt3d_line *line);
+
+/* The starting position */
+TTT3D_API ttt3d_position *ttt3d_position_new(void);
+
+/* The position of a message of TTT, NULL if it cannot be read */
+TTT3D_API ttt3d_position *ttt3d_position_parse(const char *message);
+
+TTT3D_API ttt3d_position *ttt3d_position_copy(const ttt3d_position *position);
+TTT3D_API void ttt3d_position_free(ttt3d_position *position);
+
+/* Writes the message of position and a terminating zero to buffer, returns its length */
+TTT3D_API int ttt3d_position_format(const ttt3d_position *position, char *buffer, size_t size);
+
+/* 1 or 2, the player to move */
+TTT3D_API int ttt3d_position_next_player(const ttt3d_position *position);
+
+/* 0 (empty), 1 or 2 */
+TTT3D_API int ttt3d_position_cell(const ttt3d_position *position, int cell);
+
+/* 0 while the game goes on, else 1 (X won), 2 (O won) or 3 (draw) */
+TTT3D_API int ttt3d_position_result(const ttt3d_position *position);
+
+TTT3D_API int ttt3d_position_is_over(const ttt3d_position *position);
+
+/* Writes up to capacity cells that can be played to cells, returns how many there are */
+TTT3D_API int ttt3d_position_legal_moves(const ttt3d_position *position, int *cells, int capacity);
+
+/* Plays cell for the player to move; 0 on success, -1 if it is not legal */
+TTT3D_API int ttt3d_position_play(ttt3d_position *position, int cell);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _TICTACTOE3D_ZOBRIST_HPP_
+#define _TICTACTOE3D_ZOBRIST_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+
+namespace TICTACTOE3D
+{
+
+/**
+ * Random keys of the pieces, for hashing positions
+ *
+ * The key of a position is the exclusive or of the keys of its pieces, so
+ * a move changes it by one key either way. The side to move follows from
+ * the number of pieces and needs no key of its own. The table is built
+ * at compile time from a fixed seed and shared by every player, so the
+ * keys, and what a search stores where, are the same in every run.
+ */
+struct Zobrist
+{
+    uint64_t mKeys[2][GameState::cSquares];     ///< [X or O][cell]
+
+    constexpr Zobrist()
+        :   mKeys()
+    {
+        // splitmix64
+        uint64_t lSeed = 0x9e3779b97f4a7c15ull;
+        for (int p = 0; p < 2; ++p)
+            for (int c = 0; c < GameState::cSquares; ++c)
+            {
+                uint64_t lZ = (lSeed += 0x9e3779b97f4a7c15ull);
+                lZ = (lZ ^ (lZ >> 30)) * 0xbf58476d1ce4e5b9ull;
+                lZ = (lZ ^ (lZ >> 27)) * 0x94d049bb133111ebull;
+                mKeys[p][c] = lZ ^ (lZ >> 31);
+            }
+    }
+
+    ///the key of piece \p pPlayer (CELL_X or CELL_O) on \p pCell
+    constexpr uint64_t key(int pCell, int pPlayer) const
+    {
+        return mKeys[pPlayer - 1][pCell];
+    }
+
+    ///the key of a whole position
+    uint64_t hash(const GameState &pState) const
+    {
+        uint64_t lKey = 0;
+        for (int p = 0; p < 2; ++p)
+            for (uint64_t lPieces = pState.getPieces(p + 1); lPieces; lPieces &= lPieces - 1)
+                lKey ^= mKeys[p][lowestBit(lPieces)];
+        return lKey;
+    }
+};
+
+constexpr Zobrist cZobrist;
+
+/*namespace TICTACTOE3D*/ }
+
+#endif
@@ -6,6 +6,27 @@
 namespace TICTACTOE
 {
 
+/**
+ * Returns the set of winning lines that pass through \p pCell
+ */
+const std::bitset<GameState::cLines> &GameState::cellLines(int pCell)
+{
+	static const std::vector<std::bitset<cLines> > lTable = []()
+	{
+		static const int lLines[cLines][4] = {
+			{0,1,2,3}, {4,5,6,7}, {8,9,10,11}, {12,13,14,15},
+			{0,4,8,12}, {1,5,9,13}, {2,6,10,14}, {3,7,11,15},
+			{0,5,10,15}, {3,6,9,12} };
+
+		std::vector<std::bitset<cLines> > lCells(cSquares);
+		for (int l = 0; l < cLines; ++l)
+			for (int i = 0; i < 4; ++i)
+				lCells[lLines[l][i]].set(l);
+		return lCells;
+	}();
+	return lTable[pCell];
+}
+
 /**
  * Initializes the board to the starting position
  */
@@ -20,6 +41,11 @@ GameState::GameState()
 	mLastMove = Move(Move::MOVE_BOG);
 	// Player X starts
 	mNextPlayer = CELL_X;
+	// Every line is still open to both players
+	mOpen[0].set();
+	mOpen[1].set();
+	memset(mCount, 0, sizeof(mCount));
+	mScore = 0;
 }
 
 /**
@@ -50,6 +76,15 @@ GameState::GameState(const std::string &pMessage)
 			assert("Invalid cell" && false);
 	}
 
+	// Count the pieces on every line and close the lines they block
+	mOpen[0].set();
+	mOpen[1].set();
+	memset(mCount, 0, sizeof(mCount));
+	mScore = 0;
+	for (int i = 0; i < cSquares; ++i)
+		if (mCell[i] != CELL_EMPTY)
+			addPiece(i, mCell[i]);
+
 	// Parse last move
 	mLastMove = Move(last_move);
 
@@ -84,6 +119,10 @@ GameState::GameState(const GameState &pRH,const Move &pMove)
     // Copy move status
     mNextPlayer     = pRH.mNextPlayer;
     mLastMove       = pRH.mLastMove;
+    mOpen[0]        = pRH.mOpen[0];
+    mOpen[1]        = pRH.mOpen[1];
+    memcpy(mCount, pRH.mCount, sizeof(mCount));
+    mScore          = pRH.mScore;
 
     // Perform move
     doMove(pMove);
@@ -184,6 +223,7 @@ void GameState::doMove(const Move &pMove)
 {
    // set the piece
 		at(pMove[0]) = pMove[1];
+		addPiece(pMove[0], pMove[1]);
    
     // Remember last move
     mLastMove = pMove;
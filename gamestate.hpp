@@ -4,6 +4,7 @@
 #include "constants.hpp"
 #include "move.hpp"
 #include <stdint.h>
+#include <bitset>
 #include <cassert>
 #include <cstring>
 #include <iostream>
@@ -12,6 +13,12 @@
 namespace TICTACTOE
 {
 
+/**
+ * Value of a line holding 0 to 4 pieces of one player. X adds the value
+ * of its pieces on every line and O subtracts it.
+ */
+const int cLineWeight[5] = { 0, 1, 10, 100, 1000 };
+
 /**
  * Represents a game state with a 4x4 board
  *
@@ -44,6 +51,7 @@ class GameState
 {
 public:
 	static const int cSquares = 16;		// 16 valid squares
+	static const int cLines = 10;		// 4 rows, 4 columns and 2 diagonals
 	
 	/**
 	 * Initializes the board to the starting position
@@ -166,6 +174,34 @@ private:
 	 * who is not making the move
 	 */
 	void tryMove(std::vector<Move> &pMoves, int pCell) const;
+
+	///returns the set of winning lines that pass through \p pCell
+	static const std::bitset<cLines> &cellLines(int pCell);
+
+	///updates the line bookkeeping for a piece of \p pPlayer placed on \p pCell
+	void addPiece(int pCell, uint8_t pPlayer)
+	{
+		const std::bitset<cLines> &lLines = cellLines(pCell);
+		int lWho = pPlayer - 1;
+		int lSign = (pPlayer == CELL_X) ? 1 : -1;
+		for (int l = 0; l < cLines; ++l)
+			if (lLines[l])
+			{
+				int lCount = mCount[lWho][l]++;
+				mScore += lSign * (cLineWeight[lCount + 1] - cLineWeight[lCount]);
+			}
+
+		// the lines through the cell are lost for the opponent
+		mOpen[(pPlayer ^ (CELL_X | CELL_O)) - 1] &= ~lLines;
+	}
+
+	///returns true if no line is winnable by either player after \p pPlayer plays \p pCell
+	bool isDeadAfter(int pCell, Cell pPlayer) const
+	{
+		std::bitset<cLines> lOpen = mOpen[pPlayer - 1];
+		lOpen |= mOpen[(pPlayer ^ (CELL_X | CELL_O)) - 1] & ~cellLines(pCell);
+		return lOpen.none();
+	}
 	
 	
 private:
@@ -235,19 +271,8 @@ private:
 				return 1;
 			j--;
 		}
-		//Check Draw
-		//count pieces
-		int cpieces=0;
-		for (int k = 0; k < cSquares; ++k)
-			{
-				// Try move
-				if(at(k)!=CELL_EMPTY)
-				{
-					cpieces+=1;
-				}
-			}
-			
-		if(cpieces==cSquares-1 )
+		//Check Draw: no line is left that either player can still complete
+		if(isDeadAfter(pCell,pPlayer))
 			return 2;
 		
 		return 0;
@@ -317,6 +342,24 @@ public:
 		return mNextPlayer;
 	}
 
+	/// returns true if \p pPlayer can still complete at least one line
+	bool canWin(uint8_t pPlayer) const
+	{
+		return mOpen[pPlayer - 1].any();
+	}
+
+	/// returns true if neither player can complete a line any more
+	bool isDead() const
+	{
+		return !canWin(CELL_X) && !canWin(CELL_O);
+	}
+
+	/// returns the sum of cLineWeight over all lines, kept up to date by doMove
+	int getScore() const
+	{
+		return mScore;
+	}
+
 	/// returns true if the movement marks beginning of game
 	bool isBOG() const
 	{
@@ -340,7 +383,6 @@ public:
 	/// returns true if the game ended in draw
 	bool isDraw() const
 	{
-		std::cerr << "gamestate send draw" << std::endl;
 		return mLastMove.isDraw();
 	}
 
@@ -348,6 +390,9 @@ private:
 	uint8_t mCell[cSquares];
 	uint8_t mNextPlayer;
 	Move mLastMove;
+	std::bitset<cLines> mOpen[2];	// lines still winnable by X ([0]) and O ([1])
+	uint8_t mCount[2][cLines];		// pieces of X ([0]) and O ([1]) on each line
+	int mScore;						// sum of cLineWeight over all lines
 };
 
 /*namespace TICTACTOE*/}
@@ -6,6 +6,8 @@
 
 int main(int argc, char **argv)
 {
+    TICTACTOE::Player player;
+
     // Parse parameters
     bool init = false;
     bool verbose = false;
@@ -19,6 +21,14 @@ int main(int argc, char **argv)
             verbose = true;
         else if (param == "fast" || param == "f")
             fast = true;
+        else if (param.find('=') != std::string::npos)
+        {
+            if (!player.configure(param))
+            {
+                std::cerr << "Invalid option: '" << argv[i] << "'" << std::endl;
+                return -1;
+            }
+        }
         else
         {
             std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
@@ -34,8 +44,6 @@ int main(int argc, char **argv)
         std::cout << message << std::endl;
     }
 
-    TICTACTOE::Player player;
-
     std::string input_message;
     while (std::getline(std::cin, input_message))
     {
@@ -0,0 +1,123 @@
+#include "perft.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace TICTACTOE
+{
+
+namespace
+{
+
+// The cells of the 4 rows, 4 columns and 2 diagonals
+const uint16_t cLineMask[GameState::cLines] = {
+    0x000f, 0x00f0, 0x0f00, 0xf000,
+    0x1111, 0x2222, 0x4444, 0x8888,
+    0x8421, 0x1248 };
+
+///the part of GameState that move generation needs
+struct Board
+{
+    uint16_t mPieces[2];
+};
+
+///plays \p pCell for player \p pWho (0 for X), returns false if that ends the game
+bool play(Board &pBoard, int pWho, int pCell)
+{
+    uint16_t lOwn = (pBoard.mPieces[pWho] |= uint16_t(1u << pCell));
+    bool lOpen = false;
+    for (int l = 0; l < GameState::cLines; ++l)
+    {
+        uint16_t lMask = cLineMask[l];
+        if ((lOwn & lMask) == lMask)
+            return false;
+        // a line stays winnable while one of the players has no piece on it
+        if (!(pBoard.mPieces[0] & lMask) || !(pBoard.mPieces[1] & lMask))
+            lOpen = true;
+    }
+    return lOpen;
+}
+
+uint64_t countFast(const Board &pBoard, int pWho, int pDepth)
+{
+    unsigned lEmpty = ~(unsigned)(pBoard.mPieces[0] | pBoard.mPieces[1]) & 0xffffu;
+    // Every empty cell is a move, whether it ends the game or not
+    if (pDepth == 1)
+        return __builtin_popcount(lEmpty);
+
+    uint64_t lNodes = 0;
+    for (; lEmpty; lEmpty &= lEmpty - 1)
+    {
+        Board lChild = pBoard;
+        if (play(lChild, pWho, __builtin_ctz(lEmpty)))
+            lNodes += countFast(lChild, pWho ^ 1, pDepth - 1);
+    }
+    return lNodes;
+}
+
+uint64_t countLegacy(const GameState &pState, int pDepth)
+{
+    std::vector<GameState> lChildren;
+    pState.findPossibleMoves(lChildren);
+    if (pDepth == 1)
+        return lChildren.size();
+
+    uint64_t lNodes = 0;
+    for (std::size_t i = 0; i < lChildren.size(); ++i)
+        lNodes += countLegacy(lChildren[i], pDepth - 1);
+    return lNodes;
+}
+
+/*namespace*/ }
+
+uint64_t perft(const GameState &pState, int pDepth, PerftMode pMode, int pThreads)
+{
+    if (pDepth <= 0)
+        return 1;
+    if (pState.isEOG())
+        return 0;
+
+    std::vector<GameState> lChildren;
+    pState.findPossibleMoves(lChildren);
+    if (pDepth == 1)
+        return lChildren.size();
+
+    Board lBoard = { { 0, 0 } };
+    for (int i = 0; i < GameState::cSquares; ++i)
+        if (pState.at(i) & (CELL_X | CELL_O))
+            lBoard.mPieces[pState.at(i) - 1] |= uint16_t(1u << i);
+    int lWho = pState.getNextPlayer() - 1;
+
+    // Split the moves at the root between the threads
+    std::atomic<std::size_t> lNext(0);
+    std::atomic<uint64_t> lNodes(0);
+    auto lWork = [&]()
+    {
+        uint64_t lSum = 0;
+        for (std::size_t i; (i = lNext++) < lChildren.size(); )
+        {
+            const GameState &lChild = lChildren[i];
+            if (lChild.isEOG())
+                continue;
+            if (pMode == PERFT_LEGACY)
+                lSum += countLegacy(lChild, pDepth - 1);
+            else
+            {
+                Board lNextBoard = lBoard;
+                play(lNextBoard, lWho, lChild.getMove()[0]);
+                lSum += countFast(lNextBoard, lWho ^ 1, pDepth - 1);
+            }
+        }
+        lNodes += lSum;
+    };
+
+    std::vector<std::thread> lWorkers;
+    for (int t = 1; t < pThreads; ++t)
+        lWorkers.push_back(std::thread(lWork));
+    lWork();
+    for (std::size_t t = 0; t < lWorkers.size(); ++t)
+        lWorkers[t].join();
+    return lNodes;
+}
+
+/*namespace TICTACTOE*/ }
@@ -6,10 +6,33 @@
 namespace TICTACTOE
 {
 
+Player::Player()
+    :   max_p(CELL_X),
+        min_p(CELL_O),
+        mDepth(3),
+        mNodes(0)
+{
+}
+
+bool Player::configure(const std::string &pOption)
+{
+    std::string::size_type lEqual = pOption.find('=');
+    if (lEqual == std::string::npos)
+        return false;
+    std::string lName = pOption.substr(0, lEqual);
+    std::string lValue = pOption.substr(lEqual + 1);
+
+    if (lName == "depth")
+    {
+        mDepth = atoi(lValue.c_str());
+        return mDepth > 0;
+    }
+    return false;
+}
+
 GameState Player::play(const GameState &pState,const Deadline &pDue)
 {
     int v = 0;
-    int depth = 3;
     int bestValue = 0;
     std::vector<GameState> lNextStates;
     GameState bestState;
@@ -28,10 +51,11 @@ GameState Player::play(const GameState &pState,const Deadline &pDue)
         return GameState(pState, Move());
 
     // Otherwise running Minimax for max player
+    mNodes = 0;
     bestValue = -1000000;
     for(unsigned int i = 0; i<lNextStates.size(); i++)
     {
-        v = minimax(lNextStates[i], min_p, depth - 1);
+        v = minimax(lNextStates[i], min_p, mDepth - 1);
         if(v > bestValue)
         {
             bestValue = v;
@@ -53,6 +77,12 @@ int Player::minimax(const GameState &state, uint8_t player, int depth)
     std::vector<GameState> childStates;
 //    std::vector<GameState>::iterator it;
 
+    ++mNodes;
+
+    // A dead position is a draw whatever is played, so don't expand it
+    if (state.getMove().isDraw())
+        return 0;
+
     // Finds all the possible children states
     state.findPossibleMoves(childStates);
 
@@ -109,196 +139,12 @@ int Player::evaluation(const GameState &state)
        -1 points for 1-in line
 
     Sum the score for all possible lines.
-    Check for all rows, column, and diagonals.
     4-rows, 4-column, 2-diagonal
-    and return that
-
- *    col 0  1  2  3
- * row  ---------------
- *  0  |  .  .  .  .  |  0
- *  1  |  .  .  .  .  |  1
- *  2  |  .  .  .  .  |  2
- *  3  |  .  .  .  .  |  3
- *      ---------------
- *        0  1  2  3
-
-    */
 
-    /** Problem with the above method that it cannot check for
-    3 consecutive X. It will give them same score to all 3 X
-    Have to change to give more weight to consecutive X
+    The state updates that sum for the lines through each cell
+    as moves are made, so there is nothing left to scan here.
     */
-
-    int score = 0; // Total score of the evaluation function
-
-    int num_x = 0;  // To check how many X
-    int num_o = 0;  // To check how many O
-
-
-
-    // Row-wise check
-    for(int i = 0; i<4; i++)
-    {
-        num_x = 0;
-        num_o = 0;
-        for(int j = 0; j<4; j++)
-        {
-            // Checking how many X are there in each row
-            if(state.at(i, j) == CELL_X)
-                num_x++;
-            // Checking how many O are there in each column
-            if(state.at(i, j)== CELL_O)
-                num_o++;
-        }
-
-        // Calculation of score
-        if(num_x == 4)
-            score += 1000;
-        else if(num_x == 3)
-            score += 100;
-        else if(num_x == 2)
-            score += 10;
-        else if(num_x == 1)
-            score += 1;
-
-        if(num_o == 4)
-            score -=1000;
-        else if(num_o == 3)
-            score -= 100;
-        else if(num_o == 2)
-            score -= 10;
-        else if(num_o == 1)
-            score -= 1;
-    }
-    // Make num again to zero so as to use again
-    num_o = 0;
-    num_x = 0;
-
-
-
-
-
-
-
-    // Column wise check
-    for(int i = 0; i<4; i++)
-    {
-        num_x = 0;
-        num_o = 0;
-        for(int j = 0; j<4; j++)
-        {
-            // Checking how many X are there in each row
-            if(state.at(j, i) == CELL_X)
-                num_x++;
-            // Checking how many O are there in each column
-            if(state.at(j, j)== CELL_O)
-                num_o++;
-        }
-
-        // Calculation of score
-        if(num_x == 4)
-            score += 1000;
-        else if(num_x == 3)
-            score += 100;
-        else if(num_x == 2)
-            score += 10;
-        else if(num_x == 1)
-            score += 1;
-
-        if(num_o == 4)
-            score -=1000;
-        else if(num_o == 3)
-            score -= 100;
-        else if(num_o == 2)
-            score -= 10;
-        else if(num_o == 1)
-            score -= 1;
-    }
-    // Make num again to zero so as to use again
-    num_o = 0;
-    num_x = 0;
-
-
-
-
-
-
-
-
-    // Left diagonal check
-    for(int i = 0; i<4; i++)
-    {
-        // Checking how many X are there in diagonal
-        if(state.at(i, i) == CELL_X)
-            num_x++;
-        // Checking how many O are there in diagonal
-        if(state.at(i, i)== CELL_O)
-            num_o++;
-    }
-    // Calculation of score
-    if(num_x == 4)
-        score += 1000;
-    else if(num_x == 3)
-        score += 100;
-    else if(num_x == 2)
-        score += 10;
-    else if(num_x == 1)
-        score += 1;
-
-    if(num_o == 4)
-        score -=1000;
-    else if(num_o == 3)
-        score -= 100;
-    else if(num_o == 2)
-        score -= 10;
-    else if(num_o == 1)
-        score -= 1;
-
-    // Make num again to zero so as to use again
-    num_o = 0;
-    num_x = 0;
-
-
-
-
-
-
-
-
-    // Right diagonal check
-    for(int i = 0; i<4; i++)
-    {
-        // Checking how many X are there in diagonal
-        if(state.at(i, 3-i) == CELL_X)
-            num_x++;
-        // Checking how many O are there in diagonal
-        if(state.at(i, 3-i)== CELL_O)
-            num_o++;
-    }
-    // Calculation of score
-    if(num_x == 4)
-        score += 1000;
-    else if(num_x == 3)
-        score += 100;
-    else if(num_x == 2)
-        score += 10;
-    else if(num_x == 1)
-        score += 1;
-
-    if(num_o == 4)
-        score -=1000;
-    else if(num_o == 3)
-        score -= 100;
-    else if(num_o == 2)
-        score -= 10;
-    else if(num_o == 1)
-        score -= 1;
-
-
-
-
-
-    return score;
+    return state.getScore();
 }
 
 
@@ -5,6 +5,8 @@
 #include "deadline.hpp"
 #include "move.hpp"
 #include "gamestate.hpp"
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 namespace TICTACTOE
@@ -20,9 +22,27 @@ public:
     uint8_t max_p;
     uint8_t min_p;
 
+    Player();
+
+    ///applies an option given on the command line as "name=value"
+    ///  depth=N        search N plies ahead (default 3)
+    ///\return false if the option is unknown or could not be applied
+    bool configure(const std::string &pOption);
+
     GameState play(const GameState &pState, const Deadline &pDue);
     int minimax(const GameState &state, uint8_t player, int depth);
     int evaluation(const GameState &state);
+
+    ///the depth play() searches to, as set by depth=N
+    int getDepth() const            {   return mDepth;      }
+    void setDepth(int pDepth)       {   mDepth = pDepth;    }
+
+    ///nodes searched by the last play()
+    uint64_t getLastNodes() const   {   return mNodes;      }
+
+private:
+    int mDepth;
+    uint64_t mNodes;
 };
 
 /*namespace TICTACTOE*/ }